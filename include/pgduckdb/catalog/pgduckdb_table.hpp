@@ -51,4 +51,27 @@ public:
 	TableStorageInfo GetStorageInfo(ClientContext &context) override;
 };
 
+/*
+ * Partitioned table, scanned through its leaf partitions. Their columns must
+ * be laid out like the ones of the partitioned table, the scan reads them by
+ * attribute number.
+ */
+class PostgresPartitionedTable : public PostgresHeapTable {
+public:
+	PostgresPartitionedTable(Catalog &catalog, SchemaCatalogEntry &schema, CreateTableInfo &info, ::Relation rel,
+	                         vector<::Relation> partitions, Cardinality cardinality, Snapshot snapshot);
+	~PostgresPartitionedTable() override;
+
+public:
+	static vector<::Relation> OpenLeafPartitions(::Relation rel);
+	static Cardinality GetPartitionsCardinality(const vector<::Relation> &partitions);
+
+public:
+	// -- Table API --
+	TableFunction GetScanFunction(ClientContext &context, unique_ptr<FunctionData> &bind_data) override;
+
+private:
+	vector<::Relation> partitions;
+};
+
 } // namespace duckdb
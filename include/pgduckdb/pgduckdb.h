@@ -15,6 +15,12 @@ extern char *duckdb_disabled_filesystems;
 extern bool duckdb_enable_external_access;
 extern bool duckdb_allow_unsigned_extensions;
 extern int duckdb_max_threads_per_postgres_scan;
+extern int duckdb_postgres_scan_prefetch_distance;
+extern bool duckdb_postgres_scan_zero_copy_strings;
+extern bool duckdb_postgres_scan_use_brin;
+extern bool duckdb_postgres_scan_zone_maps;
+extern bool duckdb_postgres_scan_use_index;
+extern int duckdb_postgres_scan_parallel_workers;
 extern char *duckdb_motherduck_postgres_database;
 extern int duckdb_motherduck_enabled;
 extern char *duckdb_motherduck_token;
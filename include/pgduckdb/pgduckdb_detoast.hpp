@@ -11,5 +11,7 @@ extern "C" {
 namespace pgduckdb {
 
 Datum DetoastPostgresDatum(struct varlena *value, bool *should_free);
+Datum DetoastPostgresDatumSlice(struct varlena *value, int32 slicelength, bool *should_free);
+Size PostgresDatumRawDataSize(struct varlena *value);
 
 } // namespace pgduckdb
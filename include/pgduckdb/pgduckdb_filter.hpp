@@ -1,6 +1,7 @@
 #pragma once
 
 #include "duckdb.hpp"
+#include "duckdb/planner/filter/conjunction_filter.hpp"
 
 extern "C" {
 #include "postgres.h"
@@ -10,4 +11,54 @@ namespace pgduckdb {
 
 bool ApplyValueFilter(duckdb::TableFilter &filter, Datum &value, bool is_null, Oid type_oid);
 
+class PostgresScanColumnFilter;
+
+/*
+ * One typed predicate of a compiled column filter. The select function keeps
+ * the rows of the selection that pass, values and nulls are the decoded
+ * values of the column, a row can only be NULL when walked is set for it.
+ * Selections hold at most PGDUCKDB_SCAN_BATCH_SIZE rows.
+ */
+struct PostgresScanFilterKernel {
+	typedef int (*SelectFunction)(const PostgresScanFilterKernel &kernel, const Datum *values, const bool *nulls,
+	                              const bool *walked, uint16_t *sel, int count);
+	SelectFunction select;
+	duckdb::TableFilter *filter;
+	duckdb::ExpressionType comparison;
+	duckdb::Value constant;
+	duckdb::string constant_string;
+	Oid type_oid;
+	/* Bytes of a string value that decide the filter, or -1 when the whole value is needed */
+	int32 slice_length = -1;
+	/* Values of an IN-list, searched linearly when the list is short and through the hash set otherwise */
+	duckdb::vector<int64_t> in_ints;
+	duckdb::unordered_set<int64_t> in_int_set;
+	duckdb::vector<double> in_doubles;
+	duckdb::unordered_set<double> in_double_set;
+	/* A float IN-list contains NaN, which is kept out of in_doubles because NaN == NaN is false */
+	bool in_nan = false;
+	duckdb::vector<duckdb::string> in_strings;
+	duckdb::unordered_set<std::string_view> in_string_set;
+	/* Alternatives of an OR that is not an IN-list */
+	duckdb::vector<duckdb::unique_ptr<PostgresScanColumnFilter>> or_children;
+};
+
+/*
+ * Table filters of one column compiled into a chain of typed kernels that are
+ * evaluated over a whole batch of decoded values at once.
+ */
+class PostgresScanColumnFilter {
+public:
+	PostgresScanColumnFilter(duckdb::TableFilter &filter, Oid type_oid, int value_idx);
+	int Select(const Datum *values, const bool *nulls, const bool *walked, uint16_t *sel, int count) const;
+
+	int m_value_idx;
+
+private:
+	void Compile(duckdb::TableFilter &filter, Oid type_oid);
+	bool CompileInList(duckdb::ConjunctionOrFilter &filter, Oid type_oid);
+	void FusePrefixRanges();
+	duckdb::vector<duckdb::unique_ptr<PostgresScanFilterKernel>> m_kernels;
+};
+
 } // namespace pgduckdb
@@ -23,7 +23,10 @@ int32 GetPostgresDuckDBTypemod(duckdb::LogicalType type);
 duckdb::Value ConvertPostgresParameterToDuckValue(Datum value, Oid postgres_type);
 void ConvertPostgresToDuckValue(Oid attr_type, Datum value, duckdb::Vector &result, idx_t offset);
 bool ConvertDuckToPostgresValue(TupleTableSlot *slot, duckdb::Value &value, idx_t col);
-void InsertTupleIntoChunk(duckdb::DataChunk &output, duckdb::shared_ptr<PostgresScanGlobalState> scan_global_state,
-                          duckdb::shared_ptr<PostgresScanLocalState> scan_local_state, HeapTupleData *tuple);
+void InsertTuplesIntoChunk(duckdb::DataChunk &output, duckdb::shared_ptr<PostgresScanGlobalState> scan_global_state,
+                           duckdb::shared_ptr<PostgresScanLocalState> scan_local_state, HeapTupleData *tuples,
+                           int ntuples);
+void FinalizeOutputChunk(duckdb::DataChunk &output, duckdb::shared_ptr<PostgresScanLocalState> scan_local_state,
+                         idx_t count);
 
 } // namespace pgduckdb
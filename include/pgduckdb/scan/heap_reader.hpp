@@ -4,23 +4,106 @@
 
 extern "C" {
 #include "postgres.h"
+#include "access/htup_details.h"
 #include "storage/bufmgr.h"
 }
 
 #include "pgduckdb/scan/postgres_scan.hpp"
+#include "pgduckdb/scan/postgres_zone_map.hpp"
+
+#include <atomic>
+#include <deque>
 
 namespace pgduckdb {
 
+// HeapReaderBlockChunk
+
+/*
+ * Per reader state of the block assignment. Every reader works through a
+ * contiguous chunk of blocks that it claimed from the shared counter, see
+ * HeapReaderGlobalState::AssignNextBlockNumber.
+ */
+struct HeapReaderBlockChunk {
+	HeapReaderBlockChunk() : m_nallocated(0), m_chunk_size(0), m_chunk_remaining(0) {
+	}
+	uint64_t m_nallocated;
+	uint32_t m_chunk_size;
+	uint32_t m_chunk_remaining;
+};
+
+// HeapReaderSample
+
+/*
+ * TABLESAMPLE applied by the heap readers. SYSTEM keeps whole blocks and
+ * BERNOULLI single tuples, each with probability m_percentage / 100. Whether
+ * a block or tuple is kept only depends on the seed and its position, so
+ * scans with the same seed return the same sample.
+ */
+struct HeapReaderSample {
+	enum Method : uint8_t { SYSTEM, BERNOULLI };
+	bool Keeps(BlockNumber block, OffsetNumber offset) const;
+	Method m_method;
+	double m_percentage;
+	uint32_t m_seed;
+};
+
 // HeapReaderGlobalState
 
 class HeapReaderGlobalState {
 public:
-	HeapReaderGlobalState(Relation rel)
-	    : m_nblocks(RelationGetNumberOfBlocks(rel)), m_last_assigned_block_number(InvalidBlockNumber) {
-	}
-	BlockNumber AssignNextBlockNumber(std::mutex &lock);
+	HeapReaderGlobalState(Relation rel);
+	~HeapReaderGlobalState();
+	BlockNumber AssignNextBlockNumber(HeapReaderBlockChunk &chunk);
+	void SetSample(const HeapReaderSample &sample);
+	void RestrictToBlocks(duckdb::vector<BlockNumber> blocks);
+	void RestrictToBlockRange(BlockNumber start_block, BlockNumber end_block);
+	void SynchronizeScan(Relation rel);
+	bool GetBlockRange(BlockNumber &start_block, BlockNumber &end_block) const;
 	BlockNumber m_nblocks;
-	BlockNumber m_last_assigned_block_number;
+	/* Buffer ring shared by all readers of this scan, NULL for small relations */
+	BufferAccessStrategy m_strategy;
+	/* Zone maps recorded and used by the readers, NULL when disabled */
+	duckdb::unique_ptr<PostgresScanZoneMap> m_zone_map;
+	/* Sample of the scan, NULL when the whole relation is read */
+	duckdb::unique_ptr<HeapReaderSample> m_sample;
+	/* The scan takes part in synchronized scanning, readers report their block location */
+	bool m_sync_scan;
+
+private:
+	BlockNumber AssignNextCandidateBlock(HeapReaderBlockChunk &chunk);
+
+	uint32_t m_max_chunk_size;
+	std::atomic<uint64_t> m_nallocated;
+	/* Number of blocks the assigner hands out, the relation size unless restricted */
+	uint64_t m_nscan_blocks;
+	/* Blocks [m_start_block, m_end_block) to scan, the whole relation unless restricted */
+	BlockNumber m_start_block;
+	BlockNumber m_end_block;
+	/* Ascending blocks to scan when restricted by RestrictToBlocks */
+	bool m_use_block_list;
+	duckdb::vector<BlockNumber> m_block_list;
+	/* Block a synchronized scan starts at, it wraps around to end before it */
+	BlockNumber m_sync_start_block;
+};
+
+// XidStatusCache
+
+/*
+ * Small direct mapped cache of whether the effects of a transaction are
+ * visible to the scan snapshot. Every HeapReader owns one, so it is used
+ * without any synchronization.
+ */
+class XidStatusCache {
+public:
+	enum Status : uint8_t { XID_STATUS_UNKNOWN = 0, XID_STATUS_COMMITTED, XID_STATUS_NOT_COMMITTED };
+	XidStatusCache();
+	Status Lookup(TransactionId xid) const;
+	void Store(TransactionId xid, Status status);
+
+private:
+	static constexpr int XID_STATUS_CACHE_SIZE = 256;
+	TransactionId m_xids[XID_STATUS_CACHE_SIZE];
+	uint8_t m_status[XID_STATUS_CACHE_SIZE];
 };
 
 // HeapReader
@@ -44,6 +127,10 @@ public:
 
 private:
 	Page PreparePageRead();
+	void SamplePageTuples(BlockNumber block);
+	BlockNumber NextBlockNumber();
+	void PrefetchBlocks();
+	void ReleaseCurrentBuffer();
 
 private:
 	duckdb::shared_ptr<PostgresScanGlobalState> m_global_state;
@@ -52,12 +139,21 @@ private:
 	Relation m_rel;
 	bool m_inited;
 	bool m_read_next_page;
-	bool m_page_tuples_all_visible;
 	BlockNumber m_block_number;
+	HeapReaderBlockChunk m_block_chunk;
+	/* Blocks already assigned to this reader for which a prefetch was issued */
+	std::deque<BlockNumber> m_prefetch_blocks;
+	int m_prefetch_distance;
+	bool m_prefetch_exhausted;
 	Buffer m_buffer;
-	OffsetNumber m_current_tuple_index;
-	int m_page_tuples_left;
-	HeapTupleData m_tuple;
+	bool m_buffer_locked;
+	XidStatusCache m_xid_status_cache;
+	/* Offsets of the tuples on the current page visible to the snapshot */
+	OffsetNumber m_page_tuples[MaxHeapTuplesPerPage];
+	int m_page_ntuples;
+	int m_page_tuple_index;
+	/* Tuples of the current page handed to the column decoder in one batch */
+	HeapTupleData m_batch_tuples[MaxHeapTuplesPerPage];
 };
 
 } // namespace pgduckdb
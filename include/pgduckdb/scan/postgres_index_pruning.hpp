@@ -0,0 +1,78 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+extern "C" {
+#include "postgres.h"
+#include "access/skey.h"
+#include "storage/block.h"
+#include "utils/rel.h"
+#include "utils/snapshot.h"
+}
+
+#include "pgduckdb/scan/postgres_scan.hpp"
+
+namespace pgduckdb {
+
+/*
+ * Collect the comparisons with a constant, as btree strategy and constant,
+ * that a row passing the filter must satisfy. Comparisons inside an OR are
+ * not implied by the filter, so ORs are skipped; leaving out a conjunct only
+ * makes pruning weaker.
+ */
+void PostgresScanFilterComparisons(duckdb::TableFilter &filter,
+                                   duckdb::vector<std::pair<StrategyNumber, duckdb::Value>> &comparisons);
+
+/*
+ * Convert a filter constant into a Datum of the given type, the inverse of
+ * what the scan does with column values. Returns false for types that are not
+ * supported.
+ */
+bool PostgresScanFilterConstantDatum(const duckdb::Value &constant, Oid type_oid, Datum &datum);
+
+/*
+ * Whether the index can answer scans of the relation: it is valid, usable by
+ * every snapshot and not partial, so it covers every row.
+ */
+bool PostgresScanIndexIsUsable(Relation index);
+
+/*
+ * Scan keys on the columns of the index for the pushed down filters of the
+ * scan, in index column order. Keys use btree strategy numbers and are only
+ * built for operators that have the btree meaning of the strategy in the
+ * index opfamily. Returns false when no filter could be turned into a key.
+ * Must be called with DuckdbProcessLock held.
+ */
+bool PostgresScanIndexScanKeys(Relation index, const PostgresScanGlobalState &scan_global_state,
+                               duckdb::vector<ScanKeyData> &keys);
+
+/*
+ * Estimate the fraction of the rows the scan keys select, much like the
+ * planner does for the leading index column: the matching most common values
+ * count with their frequency, the rest of the non-NULL rows is spread evenly
+ * over the other distinct values for equality, or over the histogram for
+ * ranges. Without statistics the planner defaults are used. Equality on all
+ * columns of a unique index selects a single row. Must be called with
+ * DuckdbProcessLock held.
+ */
+double PostgresScanEstimateIndexSelectivity(Relation rel, Relation index, const duckdb::vector<ScanKeyData> &keys);
+
+/*
+ * Ascending blocks of the relation that can hold rows passing the pushed
+ * down filters according to a bitmap built from its BRIN indexes and its
+ * btree indexes with a selective enough leading column, intersected over the
+ * indexes. Returns false when no index was used, every block has to be
+ * scanned then. The blocks are read whole and the filters evaluated on all
+ * their tuples, so lossy bitmap pages need no special treatment.
+ */
+bool PostgresScanBitmapBlocks(Relation rel, Snapshot snapshot, const PostgresScanGlobalState &scan_global_state,
+                              duckdb::vector<BlockNumber> &blocks);
+
+/*
+ * Whether no row of the leaf partition can pass the pushed down filters: the
+ * constant comparisons of the filters contradict its partition constraint,
+ * which includes the bounds of all its ancestors.
+ */
+bool PostgresScanPartitionExcluded(Relation partition, const PostgresScanGlobalState &scan_global_state);
+
+} // namespace pgduckdb
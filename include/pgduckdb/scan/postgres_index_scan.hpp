@@ -0,0 +1,95 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+extern "C" {
+#include "postgres.h"
+#include "access/genam.h"
+#include "access/htup_details.h"
+#include "executor/tuptable.h"
+#include "utils/rel.h"
+#include "utils/snapshot.h"
+}
+
+#include "pgduckdb/scan/postgres_scan.hpp"
+
+#include <mutex>
+
+namespace pgduckdb {
+
+// PostgresScanOrder
+
+/*
+ * Row order a postgres_seq_scan was asked for by PostgresScanOptimizer. The
+ * scan only needs to return the first m_limit rows in this order that pass
+ * the filters, DuckDB still sorts and limits the rows itself.
+ */
+struct PostgresScanOrder {
+	/* Attribute number of the order column, starting at 0 */
+	int m_attnum;
+	bool m_desc;
+	bool m_nulls_first;
+	/* NULLs are not wanted at all, as for MIN and MAX */
+	bool m_skip_nulls;
+	duckdb::idx_t m_limit;
+};
+
+// PostgresIndexScan
+
+/*
+ * Btree index scan that replaces the block by block heap scan of a
+ * postgres_seq_scan when the pushed down filters restrict the leading column
+ * of a btree index and few rows are estimated to pass them. Filters are only
+ * known when the scan starts, not when DuckDB asks the table for its scan
+ * function, so the choice is made in PostgresSeqScanInitGlobal.
+ *
+ * When no filter is selective enough, a btree index that covers all read
+ * columns replaces the heap scan if it is much smaller than the table.
+ *
+ * An ordered scan reads a btree index on the order column in the wanted
+ * direction and stops after the requested number of rows.
+ *
+ * Covering indexes are read index-only: rows on all-visible pages are formed
+ * from the index tuple without visiting the heap. Heap tuples and formed
+ * tuples are collected a batch at a time into a memory context and run
+ * through InsertTuplesIntoChunk like the tuples of a heap page, the pushed
+ * down filters are evaluated on them again. The scan is not parallel.
+ */
+class PostgresIndexScan {
+public:
+	/* Returns nullptr when no btree index is ordered, selective enough or covers the scan */
+	static duckdb::unique_ptr<PostgresIndexScan> Create(Relation rel, Snapshot snapshot,
+	                                                    duckdb::shared_ptr<PostgresScanGlobalState> global_state,
+	                                                    const PostgresScanOrder *order);
+	PostgresIndexScan(Relation rel, Relation index, duckdb::shared_ptr<PostgresScanGlobalState> global_state);
+	~PostgresIndexScan();
+	bool ReadTuples(duckdb::DataChunk &output, duckdb::shared_ptr<PostgresScanLocalState> local_state);
+
+	Relation m_rel;
+	Relation m_index;
+	/* The index covers the scan, rows of all-visible pages come from the index */
+	bool m_index_only;
+	ScanDirection m_direction;
+	IndexScanDesc m_scan;
+	TupleTableSlot *m_slot;
+	/* Holds the copies of the heap tuples of the current batch */
+	MemoryContext m_batch_context;
+	Buffer m_vmbuffer;
+	/* Table row formed from an index tuple, columns not in the index stay NULL */
+	Datum *m_heap_values;
+	bool *m_heap_nulls;
+
+private:
+	duckdb::shared_ptr<PostgresScanGlobalState> m_global_state;
+	std::mutex m_lock;
+	/* Scan keys of every pass over the index, the pass read now is m_key_set */
+	duckdb::vector<duckdb::vector<ScanKeyData>> m_key_sets;
+	duckdb::idx_t m_key_set;
+	/* Rows to return at most, 0 for no limit, and rows passing the filters so far */
+	duckdb::idx_t m_limit;
+	duckdb::idx_t m_nreturned;
+	bool m_exhausted;
+	HeapTupleData m_batch_tuples[PGDUCKDB_SCAN_BATCH_SIZE];
+};
+
+} // namespace pgduckdb
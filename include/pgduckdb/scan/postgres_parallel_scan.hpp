@@ -0,0 +1,77 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+extern "C" {
+#include "postgres.h"
+#include "access/htup_details.h"
+#include "access/parallel.h"
+#include "storage/shm_mq.h"
+#include "utils/rel.h"
+#include "utils/snapshot.h"
+}
+
+#include "pgduckdb/scan/postgres_scan.hpp"
+
+namespace pgduckdb {
+
+/* Setting of the DuckDB connection of a query whose Postgres plan allows parallel workers */
+#define PGDUCKDB_PARALLEL_SCAN_SAFE_SETTING "pgduckdb_parallel_scan_safe"
+
+// PostgresParallelScanBatch
+
+/* Tuples one DuckDB thread received from the workers, decoded without DuckdbProcessLock */
+struct PostgresParallelScanBatch {
+	/* Copies of the received messages, every one starting at a MAXALIGNed offset */
+	duckdb::vector<char> m_data;
+	duckdb::idx_t m_offsets[PGDUCKDB_SCAN_BATCH_SIZE];
+	HeapTupleData m_tuples[PGDUCKDB_SCAN_BATCH_SIZE];
+};
+
+// PostgresParallelScan
+
+/*
+ * Heap scan of a postgres_seq_scan done by Postgres parallel workers. The
+ * workers claim chunks of the block range of the scan, check the visibility
+ * of the tuples with the snapshot of the scan and send the visible ones over
+ * one shm_mq per worker to the backend. DuckDB threads receive a batch at a
+ * time under DuckdbProcessLock and run it through InsertTuplesIntoChunk
+ * without the lock, so buffer access and visibility checks scale with the
+ * workers while the backend only decodes.
+ *
+ * The backend stays in parallel mode while the workers run, so it is only
+ * used for queries whose plan the Postgres planner found parallel safe. The
+ * results of those are materialized, so the workers are done before the
+ * portal gets control back.
+ */
+class PostgresParallelScan {
+public:
+	/* Returns nullptr when no parallel workers are allowed, enabled, available or worth using */
+	static duckdb::unique_ptr<PostgresParallelScan> Create(Relation rel, Snapshot snapshot,
+	                                                       duckdb::shared_ptr<PostgresScanGlobalState> global_state,
+	                                                       BlockNumber start_block, BlockNumber end_block,
+	                                                       bool parallel_safe);
+	PostgresParallelScan(Relation rel, duckdb::shared_ptr<PostgresScanGlobalState> global_state);
+	~PostgresParallelScan();
+	bool ReadTuples(duckdb::DataChunk &output, duckdb::shared_ptr<PostgresScanLocalState> local_state,
+	                PostgresParallelScanBatch &batch);
+
+	ParallelContext *m_pcxt;
+	/* Queue of every launched worker, NULL once the worker detached from it */
+	duckdb::vector<shm_mq_handle *> m_queues;
+	int m_nattached;
+	/* Queue received from next, so the threads take turns over the workers */
+	duckdb::idx_t m_next_queue;
+	bool m_exhausted;
+	/* The workers only send ctids, for a COUNT(*) */
+	bool m_count_tuples_only;
+	Oid m_relid;
+
+private:
+	duckdb::shared_ptr<PostgresScanGlobalState> m_global_state;
+};
+
+} // namespace pgduckdb
+
+/* Entry point of the parallel workers, looked up by name in the pg_duckdb library */
+extern "C" PGDLLEXPORT void PostgresParallelScanWorkerMain(dsm_segment *seg, shm_toc *toc);
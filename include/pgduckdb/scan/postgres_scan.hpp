@@ -2,9 +2,12 @@
 
 #include "duckdb.hpp"
 
+#include "pgduckdb/pgduckdb_filter.hpp"
+
 extern "C" {
 #include "postgres.h"
 #include "miscadmin.h"
+#include "access/htup_details.h"
 #include "access/relscan.h"
 #include "executor/executor.h"
 #include "nodes/pathnodes.h"
@@ -12,6 +15,58 @@ extern "C" {
 
 namespace pgduckdb {
 
+/*
+ * Deform plan entry for every attribute up to the last read column, so that
+ * tuples can be walked without going through the TupleDesc.
+ */
+struct PostgresScanDeformAttr {
+	int16 attlen;
+	bool attbyval;
+	char attalign;
+	/* Offset in tuples without NULLs (attcacheoff), -1 past the fixed-width prefix */
+	int fixed_offset;
+	/* Index into the local state values/nulls arrays, -1 when not read */
+	int value_idx;
+};
+
+/* Deform plan entry for a read column, entries are in attribute order */
+struct PostgresScanReadColumn {
+	int attnum;
+	int value_idx;
+	Oid atttypid;
+	/* By-value column at a fixed offset, read straight from tuples without NULLs */
+	bool read_in_place;
+	bool has_missing_value;
+	Datum missing_value;
+	duckdb::TableFilter *filter;
+};
+
+/*
+ * Shape of the read columns of a scan, selects the deformer used for tuples
+ * without NULLs. Tuples with NULLs always walk all attributes.
+ */
+enum class PostgresScanDeformShape {
+	/* All read columns are in the fixed-width prefix of the row */
+	ALL_FIXED,
+	/* Some read columns follow a variable-width attribute */
+	FIXED_PREFIX_VARLENA
+};
+
+/*
+ * The rowid DuckDB reads from a Postgres table scan carries the ctid of the
+ * row, with the block number in the high bits and the offset in the low 16
+ * bits. Sorting rowids sorts rows in block order.
+ */
+static inline int64_t
+PostgresScanEncodeRowId(BlockNumber block, OffsetNumber offset) {
+	return ((int64_t)block << 16) | offset;
+}
+
+static inline void
+PostgresScanDecodeRowId(int64_t rowid, ItemPointer tid) {
+	ItemPointerSet(tid, (BlockNumber)(rowid >> 16), (OffsetNumber)(rowid & 0xFFFF));
+}
+
 class PostgresScanGlobalState {
 public:
 	PostgresScanGlobalState() : m_snapshot(nullptr), m_count_tuples_only(false), m_total_row_count(0) {
@@ -20,6 +75,12 @@ public:
 	}
 	void InitGlobalState(duckdb::TableFunctionInitInput &input);
 	void InitRelationMissingAttrs(TupleDesc tuple_desc);
+	void InitDeformPlan(TupleDesc tuple_desc);
+	void InitDictionaryColumns(Relation rel);
+	bool
+	UsesDictionary(int attnum) const {
+		return attnum < (int)m_dictionary_columns.size() && m_dictionary_columns[attnum];
+	}
 	Snapshot m_snapshot;
 	TupleDesc m_tuple_desc;
 	std::mutex m_lock; // Lock for one replacement scan
@@ -29,19 +90,100 @@ public:
 	duckdb::TableFilterSet *m_filters = nullptr;
 	std::atomic<std::uint32_t> m_total_row_count;
 	duckdb::map<int, Datum> m_relation_missing_attrs;
+	/* Deform plan, compiled once by InitDeformPlan */
+	duckdb::vector<PostgresScanDeformAttr> m_deform_attrs;
+	duckdb::vector<PostgresScanReadColumn> m_deform_read_columns;
+	/* Filters of the read columns, compiled into kernels evaluated a batch at a time */
+	duckdb::vector<PostgresScanColumnFilter> m_column_filters;
+	/* Read column written to every output vector, as index into m_deform_read_columns, -1 for the rowid */
+	duckdb::vector<int> m_output_read_columns;
+	/* The rowid is one of the output columns */
+	bool m_emit_rowid = false;
+	PostgresScanDeformShape m_deform_shape = PostgresScanDeformShape::ALL_FIXED;
+	/* Number of attributes in the fixed-width prefix of the row and its length */
+	int m_deform_fixed_natts = 0;
+	int m_deform_fixed_len = 0;
+	/* Text values of non-toasted tuples point into the pinned page (duckdb.postgres_scan_zero_copy_strings) */
+	bool m_zero_copy_strings = false;
+	/* Text columns dictionary encoded per output chunk, by attnum starting at 0, see InitDictionaryColumns */
+	duckdb::vector<bool> m_dictionary_columns;
+};
+
+/*
+ * Extra pins on the shared buffers that string vectors of an output chunk
+ * point into. The holder is attached to those vectors as auxiliary buffer, so
+ * the pins are dropped only once DuckDB released every vector that references
+ * page memory.
+ *
+ * The pins belong to the resource owner that was current when they were
+ * taken, so every holder must be destroyed before that resource owner is
+ * released: the DuckDB result and its chunks have to be dropped before the
+ * query that ran it ends, as CleanupDuckdbScanState does.
+ */
+class PostgresScanPagePins : public duckdb::VectorBuffer {
+public:
+	PostgresScanPagePins() : duckdb::VectorBuffer(duckdb::VectorBufferType::OPAQUE_BUFFER) {
+	}
+	~PostgresScanPagePins() override;
+	bool Pin(Buffer buffer);
+
+private:
+	duckdb::vector<Buffer> m_buffers;
 };
 
+/*
+ * Dictionary of the text values of one output column in the chunk being
+ * filled. As long as the column has few distinct values in the chunk, every
+ * value is stored once in m_dictionary and the rows refer to it through
+ * m_sel, the column is then emitted as DICTIONARY vector. When the dictionary
+ * overflows the column is flattened and filled as a plain vector for the rest
+ * of the chunk.
+ */
+class PostgresScanStringDictionary {
+public:
+	PostgresScanStringDictionary(const duckdb::LogicalType &type) : m_type(type) {
+		Reset();
+	}
+	void Reset();
+	bool AddValue(const char *data, idx_t len, idx_t row);
+	bool AddNull(idx_t row);
+	void Flatten(duckdb::Vector &result, idx_t count);
+
+	static constexpr idx_t MAX_SIZE = 64;
+	static constexpr idx_t HASH_TABLE_SIZE = 128;
+
+	duckdb::LogicalType m_type;
+	bool m_active;
+	duckdb::unique_ptr<duckdb::Vector> m_dictionary;
+	duckdb::SelectionVector m_sel;
+	idx_t m_size;
+	int64_t m_null_index;
+	/* Open addressing table of dictionary entry index + 1, 0 for empty slots */
+	uint8_t m_table[HASH_TABLE_SIZE];
+	duckdb::hash_t m_hashes[MAX_SIZE];
+};
+
+/*
+ * Tuples are decoded in batches of at most one heap page. The values and nulls
+ * of a batch are stored column by column, read column i of row j is at
+ * i * PGDUCKDB_SCAN_BATCH_SIZE + j. The stride is rounded up to a multiple of
+ * 64 so the nulls of a column can be packed into validity words 8 at a time.
+ */
+constexpr int PGDUCKDB_SCAN_BATCH_SIZE = ((MaxHeapTuplesPerPage + 63) / 64) * 64;
+
 class PostgresScanLocalState {
 public:
 	PostgresScanLocalState(const PostgresScanGlobalState *psgs) : m_output_vector_size(0), m_exhausted_scan(false) {
 		if (psgs->m_count_tuples_only) {
 			values = nullptr;
 			nulls = nullptr;
+			column_has_nulls = nullptr;
 		} else {
 			/* FIXME: all calls to duckdb_malloc/duckdb_free should be changed in future */
-			const auto s = psgs->m_read_columns_ids.size();
+			const auto s = psgs->m_read_columns_ids.size() * PGDUCKDB_SCAN_BATCH_SIZE;
 			values = (Datum *)duckdb_malloc(sizeof(Datum) * s);
 			nulls = (bool *)duckdb_malloc(sizeof(bool) * s);
+			column_has_nulls = (bool *)duckdb_malloc(sizeof(bool) * psgs->m_read_columns_ids.size());
 		}
 	}
 
@@ -54,12 +196,35 @@ public:
 			duckdb_free(nulls);
 			nulls = nullptr;
 		}
+		if (column_has_nulls) {
+			duckdb_free(column_has_nulls);
+			column_has_nulls = nullptr;
+		}
 	}
 
+	duckdb::buffer_ptr<duckdb::VectorBuffer> PinBatchPage();
+
 	int m_output_vector_size;
 	bool m_exhausted_scan;
+	/* Pinned buffer holding the tuples of the current batch */
+	Buffer m_batch_buffer = InvalidBuffer;
+	/* Page pins of the output chunk being filled */
+	duckdb::buffer_ptr<PostgresScanPagePins> m_page_pins;
+	/* Dictionary per output column of the chunk being filled, null for non text columns */
+	duckdb::vector<duckdb::unique_ptr<PostgresScanStringDictionary>> m_dictionaries;
+	bool m_dictionaries_inited = false;
 	Datum *values;
 	bool *nulls;
+	/* Set for the read columns that have a NULL in the current batch */
+	bool *column_has_nulls;
+	/* Data of the batch tuples whose fixed-width columns are read in place, or NULL */
+	char *batch_tuple_data[PGDUCKDB_SCAN_BATCH_SIZE];
+	/* Set for the batch rows deformed by the general walk, only those have their nulls filled in */
+	bool batch_row_walked[PGDUCKDB_SCAN_BATCH_SIZE];
+	/* Batch rows passing the filters */
+	uint16_t batch_sel[PGDUCKDB_SCAN_BATCH_SIZE];
+	/* Rowids of the batch rows, only filled when the scan emits the rowid */
+	int64_t batch_rowids[PGDUCKDB_SCAN_BATCH_SIZE];
 };
 
 duckdb::unique_ptr<duckdb::TableRef> PostgresReplacementScan(duckdb::ClientContext &context,
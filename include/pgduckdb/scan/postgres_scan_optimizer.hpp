@@ -0,0 +1,26 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/optimizer/optimizer_extension.hpp"
+
+namespace pgduckdb {
+
+// PostgresScanOptimizer
+
+/*
+ * DuckDB optimizer extension that tells postgres_seq_scans which rows the
+ * operators above them actually need. A top-N on a column of the scan, and
+ * MIN or MAX of a column without GROUP BY, only need the first rows in the
+ * order of that column. The order and row count are stored in the bind data
+ * of the scan, which then reads them through an ordered btree index scan that
+ * stops early, see PostgresIndexScan. Comparisons of the rowid with constants
+ * in a filter above the scan bound the blocks it reads. Apart from SYSTEM and
+ * BERNOULLI samples, which the scan draws itself, the plan is left unchanged.
+ */
+class PostgresScanOptimizer : public duckdb::OptimizerExtension {
+public:
+	PostgresScanOptimizer();
+	static void Optimize(duckdb::OptimizerExtensionInput &input, duckdb::unique_ptr<duckdb::LogicalOperator> &plan);
+};
+
+} // namespace pgduckdb
@@ -12,26 +12,56 @@ extern "C" {
 #include "pgduckdb/pgduckdb.h"
 #include "pgduckdb/scan/postgres_scan.hpp"
 #include "pgduckdb/scan/heap_reader.hpp"
+#include "pgduckdb/scan/postgres_index_scan.hpp"
+#include "pgduckdb/scan/postgres_parallel_scan.hpp"
 
 #include <mutex>
 #include <atomic>
 
 namespace pgduckdb {
 
+// PostgresSeqScanPartition
+
+/* Scan state of one leaf partition of a partitioned table */
+struct PostgresSeqScanPartition {
+	Relation m_rel;
+	duckdb::shared_ptr<PostgresScanGlobalState> m_global_state;
+	duckdb::shared_ptr<HeapReaderGlobalState> m_heap_reader_global_state;
+};
+
+struct PostgresSeqScanLocalState;
+
 // Global State
 
+/*
+ * A partitioned table is scanned as its leaf partitions that are not pruned,
+ * one after the other. The readers of all threads claim blocks of the same
+ * partition and move on to the next together once its blocks are assigned,
+ * so the blocks of all partitions form one work queue. The first partition
+ * is the one of m_rel, m_global_state and m_heap_reader_global_state.
+ */
 struct PostgresSeqScanGlobalState : public duckdb::GlobalTableFunctionState {
-	explicit PostgresSeqScanGlobalState(Relation rel, duckdb::TableFunctionInitInput &input);
+	PostgresSeqScanGlobalState(Relation rel, duckdb::shared_ptr<PostgresScanGlobalState> global_state,
+	                           duckdb::shared_ptr<HeapReaderGlobalState> heap_reader_global_state);
 	~PostgresSeqScanGlobalState();
 	idx_t
 	MaxThreads() const override {
-		return duckdb_max_threads_per_postgres_scan;
+		return m_index_scan ? 1 : duckdb_max_threads_per_postgres_scan;
 	}
+	bool NextPartition(PostgresSeqScanLocalState &local_state);
 
 public:
 	duckdb::shared_ptr<PostgresScanGlobalState> m_global_state;
 	duckdb::shared_ptr<HeapReaderGlobalState> m_heap_reader_global_state;
+	/* Index scan used instead of the heap readers, NULL for a heap scan */
+	duckdb::unique_ptr<PostgresIndexScan> m_index_scan;
+	/* Parallel workers reading the heap instead of the heap readers, NULL when the backend reads it */
+	duckdb::unique_ptr<PostgresParallelScan> m_parallel_scan;
 	Relation m_rel;
+	/* Leaf partitions to scan, empty when the scanned relation is not partitioned */
+	duckdb::vector<PostgresSeqScanPartition> m_partitions;
+	/* Partition the readers claim blocks from */
+	std::atomic<idx_t> m_partition;
 };
 
 // Local State
@@ -45,6 +75,10 @@ public:
 public:
 	duckdb::shared_ptr<PostgresScanLocalState> m_local_state;
 	duckdb::unique_ptr<HeapReader> m_heap_table_reader;
+	/* Tuples received from the parallel workers, created on first use */
+	duckdb::unique_ptr<PostgresParallelScanBatch> m_parallel_batch;
+	/* Partition m_heap_table_reader reads, see PostgresSeqScanGlobalState */
+	idx_t m_partition = 0;
 };
 
 // PostgresSeqScanFunctionData
@@ -58,6 +92,15 @@ public:
 	::Relation m_rel;
 	uint64_t m_cardinality;
 	Snapshot m_snapshot;
+	/* Order and limit pushed down by PostgresScanOptimizer, NULL when the scan is unordered */
+	duckdb::unique_ptr<PostgresScanOrder> m_order;
+	/* Blocks [m_start_block, m_end_block) holding the rowids a filter above the scan allows */
+	BlockNumber m_start_block;
+	BlockNumber m_end_block;
+	/* TABLESAMPLE taken over from DuckDB by PostgresScanOptimizer, NULL without one */
+	duckdb::unique_ptr<HeapReaderSample> m_sample;
+	/* Leaf partitions of a partitioned m_rel, owned by its catalog entry */
+	duckdb::vector<::Relation> m_partitions;
 };
 
 // PostgresSeqScanFunction
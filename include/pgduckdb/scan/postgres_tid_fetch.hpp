@@ -0,0 +1,76 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+extern "C" {
+#include "postgres.h"
+#include "access/htup_details.h"
+#include "storage/buf.h"
+#include "utils/rel.h"
+#include "utils/snapshot.h"
+}
+
+namespace pgduckdb {
+
+// PostgresTidFetchFunctionData
+
+struct PostgresTidFetchFunctionData : public duckdb::TableFunctionData {
+public:
+	PostgresTidFetchFunctionData(::Relation rel, Snapshot snapshot);
+	~PostgresTidFetchFunctionData() override;
+
+public:
+	::Relation m_rel;
+	Snapshot m_snapshot;
+	BlockNumber m_nblocks;
+	/* Attribute numbers of the fetched columns, starting at 1 */
+	duckdb::vector<AttrNumber> m_attnums;
+};
+
+// PostgresTidFetchLocalState
+
+struct PostgresTidFetchLocalState : public duckdb::LocalTableFunctionState {
+public:
+	explicit PostgresTidFetchLocalState(idx_t ncolumns);
+	~PostgresTidFetchLocalState() override;
+
+public:
+	/* Input rowids with their input row, sorted into block order */
+	duckdb::vector<std::pair<int64_t, idx_t>> m_rowids;
+	/* Values of the visible tuples of one block, column by column */
+	Datum *m_values;
+	bool *m_nulls;
+	/* Pinned buffer of the block being converted */
+	Buffer m_buffer;
+};
+
+// PostgresTidFetchFunction
+
+/*
+ * Table in-out function returning columns of the rows of a Postgres table
+ * whose rowid comes in, the rowids typically come from a postgres_seq_scan
+ * that only read narrow columns:
+ *
+ *   FROM postgres_tid_fetch((SELECT rowid FROM pgduckdb.public.t WHERE ...), 'public.t', columns := ['doc'])
+ *
+ * The output is the rowid followed by the requested columns. Rows that are
+ * not visible to the snapshot are left out.
+ */
+struct PostgresTidFetchFunction : public duckdb::TableFunction {
+public:
+	PostgresTidFetchFunction();
+
+public:
+	static duckdb::unique_ptr<duckdb::FunctionData> PostgresTidFetchBind(duckdb::ClientContext &context,
+	                                                                     duckdb::TableFunctionBindInput &input,
+	                                                                     duckdb::vector<duckdb::LogicalType> &types,
+	                                                                     duckdb::vector<duckdb::string> &names);
+	static duckdb::unique_ptr<duckdb::LocalTableFunctionState>
+	PostgresTidFetchInitLocal(duckdb::ExecutionContext &context, duckdb::TableFunctionInitInput &input,
+	                          duckdb::GlobalTableFunctionState *gstate);
+	static duckdb::OperatorResultType PostgresTidFetchFunc(duckdb::ExecutionContext &context,
+	                                                       duckdb::TableFunctionInput &data, duckdb::DataChunk &input,
+	                                                       duckdb::DataChunk &output);
+};
+
+} // namespace pgduckdb
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+extern "C" {
+#include "postgres.h"
+#include "access/stratnum.h"
+#include "access/xlogdefs.h"
+#include "storage/block.h"
+#include "storage/bufpage.h"
+#include "utils/rel.h"
+}
+
+#include "pgduckdb/scan/postgres_scan.hpp"
+
+#include <mutex>
+
+namespace pgduckdb {
+
+#define PGDUCKDB_ZONE_MAP_RANGE_BLOCKS 16
+
+/* Zone map value, integers (and bool, date and timestamps) in i, floats in f */
+union PostgresZoneMapValue {
+	int64_t i;
+	double f;
+};
+
+/*
+ * Min/max of one column over the recorded blocks of a block range. The
+ * bounds only ever widen, so they cover every version a block had when it
+ * was recorded.
+ */
+struct PostgresZoneMapRange {
+	PostgresZoneMapRange();
+	/* Page LSN of every block when it was recorded, InvalidXLogRecPtr for blocks that were not */
+	XLogRecPtr m_lsns[PGDUCKDB_ZONE_MAP_RANGE_BLOCKS];
+	/* Some recorded block holds a non-NULL value */
+	bool m_has_values;
+	/* Some recorded block holds a NaN, which sorts above every other float */
+	bool m_has_nan;
+	PostgresZoneMapValue m_min;
+	PostgresZoneMapValue m_max;
+};
+
+/* Zone maps of the columns of one relation file */
+struct PostgresZoneMapRelation {
+	~PostgresZoneMapRelation();
+	std::mutex m_lock;
+	Oid m_relfilenode;
+	/* Block ranges by range number for every recorded column, keyed by attnum starting at 0 */
+	duckdb::map<int, duckdb::vector<PostgresZoneMapRange>> m_columns;
+};
+
+// PostgresScanZoneMap
+
+/*
+ * Zone maps of a relation as used by one scan. They are kept in a backend
+ * local cache and filled by the scans themselves: every block read is
+ * summarized for the by-value fixed-width read columns, unless it was already
+ * recorded with the same page LSN. Blocks are summarized over all their line
+ * pointers, visible or not, so the summary holds for every snapshot.
+ *
+ * A block is skipped when its page LSN is still the one it was recorded with
+ * and the range bounds of a filtered column exclude the constant comparisons
+ * of its filter. Any change of the tuples on a page of a WAL-logged relation
+ * moves its LSN, a rewrite changes the relfilenode and drops the zone maps.
+ * The LSN can only be checked on the page itself, so a skipped block is still
+ * read into shared buffers and share locked, only its visibility checks and
+ * the decoding of its tuples are saved.
+ *
+ * The zone maps of a relation are dropped on its relcache invalidation. A
+ * block range takes 152 bytes per recorded column, a backend holds at most
+ * PGDUCKDB_ZONE_MAP_MAX_RANGES (2^18) of them, about 40MB, and records no
+ * further ranges until invalidations free some.
+ */
+class PostgresScanZoneMap {
+public:
+	/* Returns nullptr when the scan neither records nor uses zone maps */
+	static duckdb::unique_ptr<PostgresScanZoneMap> Create(Relation rel,
+	                                                      const PostgresScanGlobalState &scan_global_state);
+	bool CanSkipBlock(BlockNumber block, XLogRecPtr lsn);
+	void RecordBlock(BlockNumber block, XLogRecPtr lsn, Page page, OffsetNumber max_offset);
+
+private:
+	struct Column {
+		int attnum;
+		Oid type_oid;
+		bool is_float;
+		bool has_missing_value;
+		Datum missing_value;
+	};
+	struct Comparison {
+		int attnum;
+		bool is_float;
+		StrategyNumber strategy;
+		PostgresZoneMapValue value;
+	};
+
+	bool BlockIsRecorded(BlockNumber block, XLogRecPtr lsn);
+	void SummarizeTuple(HeapTupleHeader tup, duckdb::vector<PostgresZoneMapRange> &summaries);
+
+	duckdb::shared_ptr<PostgresZoneMapRelation> m_relation;
+	/* Deform plan of the scan up to the last recorded column */
+	duckdb::vector<PostgresScanDeformAttr> m_deform_attrs;
+	/* Index into m_columns by attnum, -1 for the attributes that are not recorded */
+	duckdb::vector<int> m_column_idx;
+	duckdb::vector<Column> m_columns;
+	duckdb::vector<Comparison> m_comparisons;
+};
+
+/* Registers the relcache callback that drops the zone maps of invalidated relations */
+void DuckdbInitZoneMaps(void);
+
+} // namespace pgduckdb
@@ -14,6 +14,7 @@ extern "C" {
 #include "storage/bufmgr.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_class.h"
+#include "catalog/pg_inherits.h"
 #include "optimizer/planmain.h"
 #include "optimizer/planner.h"
 #include "optimizer/plancat.h"
@@ -21,6 +22,7 @@ extern "C" {
 #include "utils/regproc.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
+#include "utils/lsyscache.h"
 #include "utils/relcache.h"
 #include "access/htup_details.h"
 #include "parser/parsetree.h"
@@ -93,4 +95,116 @@ PostgresHeapTable::GetStorageInfo(ClientContext &context) {
 	throw duckdb::NotImplementedException("GetStorageInfo not supported yet");
 }
 
+//===--------------------------------------------------------------------===//
+// PostgresPartitionedTable
+//===--------------------------------------------------------------------===//
+
+PostgresPartitionedTable::PostgresPartitionedTable(Catalog &catalog, SchemaCatalogEntry &schema,
+                                                   CreateTableInfo &info, ::Relation rel,
+                                                   vector<::Relation> partitions, Cardinality cardinality,
+                                                   Snapshot snapshot)
+    : PostgresHeapTable(catalog, schema, info, rel, cardinality, snapshot), partitions(std::move(partitions)) {
+}
+
+PostgresPartitionedTable::~PostgresPartitionedTable() {
+	std::lock_guard<std::mutex> lock(pgduckdb::DuckdbProcessLock::GetLock());
+	for (auto partition : partitions) {
+		RelationClose(partition);
+	}
+}
+
+/*
+ * Opens the leaf partitions of rel that are plain tables into partitions. Returns
+ * false when some leaf is a foreign table, which postgres_seq_scan cannot read.
+ */
+static bool
+OpenLeafRelations(Oid relid, vector<::Relation> *partitions) {
+	bool all_tables = true;
+	List *inheritors = find_all_inheritors(relid, AccessShareLock, NULL);
+	ListCell *lc;
+	foreach (lc, inheritors) {
+		Oid inheritor = lfirst_oid(lc);
+		char relkind = get_rel_relkind(inheritor);
+		if (relkind == RELKIND_RELATION) {
+			partitions->push_back(RelationIdGetRelation(inheritor));
+		} else if (relkind == RELKIND_FOREIGN_TABLE) {
+			all_tables = false;
+		}
+	}
+	list_free(inheritors);
+	return all_tables;
+}
+
+static bool
+SameColumnLayout(::Relation rel, ::Relation partition) {
+	auto desc = RelationGetDescr(rel);
+	auto partition_desc = RelationGetDescr(partition);
+	if (desc->natts != partition_desc->natts) {
+		return false;
+	}
+	for (int i = 0; i < desc->natts; i++) {
+		auto attr = TupleDescAttr(desc, i);
+		auto partition_attr = TupleDescAttr(partition_desc, i);
+		if (attr->attisdropped || partition_attr->attisdropped) {
+			if (attr->attisdropped != partition_attr->attisdropped) {
+				return false;
+			}
+			continue;
+		}
+		if (strcmp(NameStr(attr->attname), NameStr(partition_attr->attname)) != 0 ||
+		    attr->atttypid != partition_attr->atttypid || attr->atttypmod != partition_attr->atttypmod) {
+			return false;
+		}
+	}
+	return true;
+}
+
+vector<::Relation>
+PostgresPartitionedTable::OpenLeafPartitions(::Relation rel) {
+	vector<::Relation> partitions;
+	bool all_tables;
+	{
+		std::lock_guard<std::mutex> lock(pgduckdb::DuckdbProcessLock::GetLock());
+		all_tables = pgduckdb::PostgresFunctionGuard<bool>(OpenLeafRelations, RelationGetRelid(rel), &partitions);
+	}
+
+	bool same_layout = true;
+	for (auto partition : partitions) {
+		same_layout = same_layout && SameColumnLayout(rel, partition);
+	}
+	if (all_tables && same_layout) {
+		return partitions;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(pgduckdb::DuckdbProcessLock::GetLock());
+		for (auto partition : partitions) {
+			RelationClose(partition);
+		}
+	}
+	if (!all_tables) {
+		throw duckdb::NotImplementedException("Partitioned table \"%s\" has foreign table partitions",
+		                                      RelationGetRelationName(rel));
+	}
+	throw duckdb::NotImplementedException(
+	    "Partitioned table \"%s\" has partitions whose columns are not laid out like its own",
+	    RelationGetRelationName(rel));
+}
+
+Cardinality
+PostgresPartitionedTable::GetPartitionsCardinality(const vector<::Relation> &partitions) {
+	Cardinality cardinality = 0;
+	for (auto partition : partitions) {
+		cardinality += GetTableCardinality(partition);
+	}
+	return cardinality;
+}
+
+TableFunction
+PostgresPartitionedTable::GetScanFunction(ClientContext &context, unique_ptr<FunctionData> &bind_data) {
+	auto function = PostgresHeapTable::GetScanFunction(context, bind_data);
+	bind_data->Cast<pgduckdb::PostgresSeqScanFunctionData>().m_partitions = partitions;
+	return function;
+}
+
 } // namespace duckdb
@@ -1,6 +1,7 @@
 #include "pgduckdb/catalog/pgduckdb_catalog.hpp"
 #include "pgduckdb/catalog/pgduckdb_transaction.hpp"
 #include "pgduckdb/catalog/pgduckdb_table.hpp"
+#include "pgduckdb/pgduckdb_process_lock.hpp"
 #include "pgduckdb/scan/postgres_scan.hpp"
 #include "duckdb/parser/parsed_data/create_table_info.hpp"
 #include "duckdb/parser/parsed_data/create_schema_info.hpp"
@@ -24,6 +25,7 @@ extern "C" {
 #include "nodes/nodeFuncs.h"
 #include "parser/parsetree.h"
 #include "utils/rel.h"
+#include "utils/relcache.h"
 }
 
 namespace duckdb {
@@ -73,6 +75,7 @@ SchemaItems::GetTable(const string &entry_name) {
 		return nullptr;
 	}
 
+	bool is_partitioned = relForm->relkind == RELKIND_PARTITIONED_TABLE;
 	ReleaseSysCache(tuple);
 
 	::Relation rel = PostgresTable::OpenRelation(rel_oid);
@@ -81,8 +84,24 @@ SchemaItems::GetTable(const string &entry_name) {
 	info.table = entry_name;
 	PostgresTable::SetTableInfo(info, rel);
 
-	auto cardinality = PostgresTable::GetTableCardinality(rel);
-	auto table = make_uniq<PostgresHeapTable>(catalog, *schema, info, rel, cardinality, snapshot);
+	unique_ptr<PostgresTable> table;
+	if (is_partitioned) {
+		// A partitioned table has no storage of its own, it is scanned through its leaf partitions
+		vector<::Relation> partitions;
+		try {
+			partitions = PostgresPartitionedTable::OpenLeafPartitions(rel);
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(pgduckdb::DuckdbProcessLock::GetLock());
+			RelationClose(rel);
+			throw;
+		}
+		auto cardinality = PostgresPartitionedTable::GetPartitionsCardinality(partitions);
+		table = make_uniq<PostgresPartitionedTable>(catalog, *schema, info, rel, std::move(partitions), cardinality,
+		                                            snapshot);
+	} else {
+		auto cardinality = PostgresTable::GetTableCardinality(rel);
+		table = make_uniq<PostgresHeapTable>(catalog, *schema, info, rel, cardinality, snapshot);
+	}
 	tables[entry_name] = std::move(table);
 	return tables[entry_name].get();
 }
@@ -9,11 +9,18 @@ extern "C" {
 #include "pgduckdb/pgduckdb.h"
 #include "pgduckdb/pgduckdb_node.hpp"
 #include "pgduckdb/pgduckdb_background_worker.hpp"
+#include "pgduckdb/scan/postgres_zone_map.hpp"
 
 static void DuckdbInitGUC(void);
 
 bool duckdb_force_execution = false;
 int duckdb_max_threads_per_postgres_scan = 1;
+int duckdb_postgres_scan_prefetch_distance = 32;
+bool duckdb_postgres_scan_zero_copy_strings = false;
+bool duckdb_postgres_scan_use_brin = true;
+bool duckdb_postgres_scan_zone_maps = true;
+bool duckdb_postgres_scan_use_index = true;
+int duckdb_postgres_scan_parallel_workers = 0;
 int duckdb_motherduck_enabled = MotherDuckEnabled::MOTHERDUCK_AUTO;
 char *duckdb_motherduck_token = strdup("");
 char *duckdb_motherduck_postgres_database = strdup("postgres");
@@ -39,6 +46,7 @@ _PG_init(void) {
 	DuckdbInitHooks();
 	DuckdbInitNode();
 	DuckdbInitBackgroundWorker();
+	pgduckdb::DuckdbInitZoneMaps();
 }
 } // extern "C"
 
@@ -142,6 +150,33 @@ DuckdbInitGUC(void) {
 	                     "Maximum number of DuckDB threads used for a single Postgres scan",
 	                     &duckdb_max_threads_per_postgres_scan, 1, 64);
 
+	DefineCustomVariable("duckdb.postgres_scan_prefetch_distance",
+	                     "Number of upcoming blocks each Postgres scan thread prefetches, 0 disables prefetching",
+	                     &duckdb_postgres_scan_prefetch_distance, 0, 1024);
+
+	DefineCustomVariable("duckdb.postgres_scan_zero_copy_strings",
+	                     "Let Postgres scans return text values that point into pinned shared buffers",
+	                     &duckdb_postgres_scan_zero_copy_strings);
+
+	DefineCustomVariable("duckdb.postgres_scan_use_brin",
+	                     "Let Postgres scans skip block ranges that BRIN indexes exclude for the pushed down filters",
+	                     &duckdb_postgres_scan_use_brin);
+
+	DefineCustomVariable("duckdb.postgres_scan_zone_maps",
+	                     "Let Postgres scans record min/max of fixed-width columns per block range and skip the blocks "
+	                     "they exclude for the pushed down filters",
+	                     &duckdb_postgres_scan_zone_maps);
+
+	DefineCustomVariable("duckdb.postgres_scan_use_index",
+	                     "Let Postgres scans read through a btree index when the pushed down filters on its leading "
+	                     "column are estimated to select few rows",
+	                     &duckdb_postgres_scan_use_index);
+
+	DefineCustomVariable("duckdb.postgres_scan_parallel_workers",
+	                     "Number of Postgres parallel workers that read the heap for a Postgres scan of a parallel "
+	                     "safe query, at most max_parallel_workers are used, 0 reads it in the backend",
+	                     &duckdb_postgres_scan_parallel_workers, 0, 1024);
+
 	DefineCustomVariable("duckdb.postgres_role",
 	                     "Which postgres role should be allowed to use DuckDB execution, use the secrets and create "
 	                     "MotherDuck tables. Defaults to superusers only",
@@ -73,6 +73,53 @@ Lz4DecompresDatum(const struct varlena *value) {
 #endif
 }
 
+static struct varlena *
+PglzDecompressDatumSlice(const struct varlena *value, int32 slicelength) {
+	struct varlena *result;
+	int32 raw_size;
+
+	result = (struct varlena *)duckdb_malloc(slicelength + VARHDRSZ);
+
+	raw_size = pglz_decompress((char *)value + VARHDRSZ_COMPRESSED, VARSIZE(value) - VARHDRSZ_COMPRESSED,
+	                           VARDATA(result), slicelength, false);
+	if (raw_size < 0) {
+		duckdb_free(result);
+		throw duckdb::InvalidInputException("(PGDuckDB/PglzDecompressDatumSlice) Compressed pglz data is corrupt");
+	}
+
+	SET_VARSIZE(result, raw_size + VARHDRSZ);
+
+	return result;
+}
+
+static struct varlena *
+Lz4DecompressDatumSlice(const struct varlena *value, int32 slicelength) {
+#ifndef USE_LZ4
+	return NULL; /* keep compiler quiet */
+#else
+	int32 raw_size;
+	struct varlena *result;
+
+	/* slice decompression not supported prior to 1.8.3 */
+	if (LZ4_versionNumber() < 10803) {
+		return Lz4DecompresDatum(value);
+	}
+
+	result = (struct varlena *)duckdb_malloc(slicelength + VARHDRSZ);
+
+	raw_size = LZ4_decompress_safe_partial((char *)value + VARHDRSZ_COMPRESSED, VARDATA(result),
+	                                       VARSIZE(value) - VARHDRSZ_COMPRESSED, slicelength, slicelength);
+	if (raw_size < 0) {
+		duckdb_free(result);
+		throw duckdb::InvalidInputException("(PGDuckDB/Lz4DecompressDatumSlice) Compressed lz4 data is corrupt");
+	}
+
+	SET_VARSIZE(result, raw_size + VARHDRSZ);
+
+	return result;
+#endif
+}
+
 static struct varlena *
 ToastDecompressDatum(struct varlena *attr) {
 	ToastCompressionId cmid;
@@ -89,6 +136,26 @@ ToastDecompressDatum(struct varlena *attr) {
 	}
 }
 
+static struct varlena *
+ToastDecompressDatumSlice(struct varlena *attr, int32 slicelength) {
+	if (slicelength >= (int32)VARDATA_COMPRESSED_GET_EXTSIZE(attr)) {
+		return ToastDecompressDatum(attr);
+	}
+
+	ToastCompressionId cmid;
+	cmid = (ToastCompressionId)TOAST_COMPRESS_METHOD(attr);
+	switch (cmid) {
+	case TOAST_PGLZ_COMPRESSION_ID:
+		return PglzDecompressDatumSlice(attr, slicelength);
+	case TOAST_LZ4_COMPRESSION_ID:
+		return Lz4DecompressDatumSlice(attr, slicelength);
+	default:
+		throw duckdb::InvalidInputException("(PGDuckDB/ToastDecompressDatumSlice) Invalid compression method id %d",
+		                                    TOAST_COMPRESS_METHOD(attr));
+		return NULL; /* keep compiler quiet */
+	}
+}
+
 static struct varlena *
 ToastFetchDatum(struct varlena *attr) {
 	Relation toast_rel;
@@ -133,6 +200,63 @@ ToastFetchDatum(struct varlena *attr) {
 	return result;
 }
 
+/*
+ * Fetch the first slicelength bytes of an on-disk value. For a compressed
+ * value these are bytes of the compressed data, including the compression
+ * header that is stored in front of it.
+ */
+static struct varlena *
+ToastFetchDatumSlice(struct varlena *attr, int32 slicelength) {
+	Relation toast_rel;
+	struct varlena *result;
+	struct varatt_external toast_pointer;
+	int32 attrsize;
+
+	if (!VARATT_IS_EXTERNAL_ONDISK(attr)) {
+		throw duckdb::InvalidInputException(
+		    "(PGDuckDB/ToastFetchDatumSlice) Shouldn't be called for non-ondisk datums");
+	}
+
+	/* Must copy to access aligned fields */
+	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+	attrsize = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
+
+	if (VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer)) {
+		slicelength += sizeof(int32);
+	}
+	if (slicelength > attrsize) {
+		slicelength = attrsize;
+	}
+
+	result = (struct varlena *)duckdb_malloc(slicelength + VARHDRSZ);
+
+	if (VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer)) {
+		SET_VARSIZE_COMPRESSED(result, slicelength + VARHDRSZ);
+	} else {
+		SET_VARSIZE(result, slicelength + VARHDRSZ);
+	}
+
+	if (slicelength == 0) {
+		return result;
+	}
+
+	std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+
+	toast_rel = PostgresFunctionGuard<Relation>(try_table_open, toast_pointer.va_toastrelid, AccessShareLock);
+
+	if (toast_rel == NULL) {
+		throw duckdb::InternalException("(PGDuckDB/ToastFetchDatumSlice) Error toast relation is NULL");
+	}
+
+	PostgresFunctionGuard(table_relation_fetch_toast_slice, toast_rel, toast_pointer.va_valueid, attrsize, 0,
+	                      slicelength, result);
+
+	PostgresFunctionGuard(table_close, toast_rel, AccessShareLock);
+
+	return result;
+}
+
 Datum
 DetoastPostgresDatum(struct varlena *attr, bool *should_free) {
 	struct varlena *toasted_value = nullptr;
@@ -178,4 +302,64 @@ DetoastPostgresDatum(struct varlena *attr, bool *should_free) {
 	return reinterpret_cast<Datum>(toasted_value);
 }
 
+/*
+ * Like DetoastPostgresDatum, but only the first slicelength bytes of the data
+ * are guaranteed to be present in the result, the value may be cut off after
+ * them. Only the part of an on-disk value that is needed is fetched from the
+ * TOAST table and compressed data is only decompressed up to slicelength.
+ */
+Datum
+DetoastPostgresDatumSlice(struct varlena *attr, int32 slicelength, bool *should_free) {
+	struct varlena *toasted_value = nullptr;
+
+	if (VARATT_IS_EXTERNAL_ONDISK(attr)) {
+		struct varatt_external toast_pointer;
+		VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+		if (!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer)) {
+			*should_free = true;
+			return reinterpret_cast<Datum>(ToastFetchDatumSlice(attr, slicelength));
+		}
+
+		/* lz4 data can't be cut off at a known position, the whole value is needed */
+		int32 max_size = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
+		if (VARATT_EXTERNAL_GET_COMPRESS_METHOD(toast_pointer) == TOAST_PGLZ_COMPRESSION_ID) {
+			max_size = pglz_maximum_compressed_size(slicelength, max_size);
+		}
+		toasted_value = ToastFetchDatumSlice(attr, max_size);
+	} else if (VARATT_IS_COMPRESSED(attr)) {
+		toasted_value = attr;
+	} else {
+		return DetoastPostgresDatum(attr, should_free);
+	}
+
+	struct varlena *decompressed = ToastDecompressDatumSlice(toasted_value, slicelength);
+	if (toasted_value != attr) {
+		duckdb_free(toasted_value);
+	}
+	*should_free = true;
+	return reinterpret_cast<Datum>(decompressed);
+}
+
+/*
+ * Length of the data of a varlena once it is detoasted, read from its header
+ * or TOAST pointer without fetching or decompressing anything.
+ */
+Size
+PostgresDatumRawDataSize(struct varlena *attr) {
+	if (VARATT_IS_EXTERNAL_ONDISK(attr)) {
+		struct varatt_external toast_pointer;
+		VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+		return toast_pointer.va_rawsize - VARHDRSZ;
+	} else if (VARATT_IS_EXTERNAL_INDIRECT(attr)) {
+		struct varatt_indirect redirect;
+		VARATT_EXTERNAL_GET_POINTER(redirect, attr);
+		return PostgresDatumRawDataSize(redirect.pointer);
+	} else if (VARATT_IS_EXTERNAL_EXPANDED(attr)) {
+		return EOH_get_flat_size(DatumGetEOHP(PointerGetDatum(attr))) - VARHDRSZ;
+	} else if (VARATT_IS_COMPRESSED(attr)) {
+		return VARDATA_COMPRESSED_GET_EXTSIZE(attr);
+	}
+	return VARSIZE_ANY_EXHDR(attr);
+}
+
 } // namespace pgduckdb
@@ -16,7 +16,9 @@ extern "C" {
 #include "pgduckdb/pgduckdb_duckdb.hpp"
 #include "pgduckdb/pgduckdb_metadata_cache.hpp"
 #include "pgduckdb/scan/postgres_scan.hpp"
+#include "pgduckdb/scan/postgres_scan_optimizer.hpp"
 #include "pgduckdb/scan/postgres_seq_scan.hpp"
+#include "pgduckdb/scan/postgres_tid_fetch.hpp"
 #include "pgduckdb/pgduckdb_utils.hpp"
 #include "pgduckdb/catalog/pgduckdb_storage.hpp"
 
@@ -41,6 +43,8 @@ DuckDBManager::Initialize() {
 	config.SetOptionByName("extension_directory", CreateOrGetDirectoryPath("duckdb_extensions"));
 	// Transforms VIEWs into their view definition
 	config.replacement_scans.emplace_back(pgduckdb::PostgresReplacementScan);
+	// Pushes ORDER BY ... LIMIT, MIN/MAX, rowid ranges and samples down into postgres_seq_scan
+	config.optimizer_extensions.push_back(pgduckdb::PostgresScanOptimizer());
 	SET_DUCKDB_OPTION(allow_unsigned_extensions);
 	SET_DUCKDB_OPTION(enable_external_access);
 
@@ -110,12 +114,15 @@ void
 DuckDBManager::LoadFunctions(duckdb::ClientContext &context) {
 	pgduckdb::PostgresSeqScanFunction seq_scan_fun;
 	duckdb::CreateTableFunctionInfo seq_scan_info(seq_scan_fun);
+	pgduckdb::PostgresTidFetchFunction tid_fetch_fun;
+	duckdb::CreateTableFunctionInfo tid_fetch_info(tid_fetch_fun);
 
 	auto &catalog = duckdb::Catalog::GetSystemCatalog(context);
 	context.transaction.BeginTransaction();
 	auto &instance = *database->instance;
 	duckdb::ExtensionUtil::RegisterType(instance, "UnsupportedPostgresType", duckdb::LogicalTypeId::VARCHAR);
 	catalog.CreateTableFunction(context, &seq_scan_info);
+	catalog.CreateTableFunction(context, &tid_fetch_info);
 	context.transaction.Commit();
 }
 
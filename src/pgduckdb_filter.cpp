@@ -1,8 +1,11 @@
 #include "duckdb.hpp"
 #include "duckdb/planner/filter/constant_filter.hpp"
+#include "duckdb/planner/filter/conjunction_filter.hpp"
+#include "duckdb/planner/filter/optional_filter.hpp"
 
 extern "C" {
 #include "postgres.h"
+#include "access/htup_details.h"
 #include "catalog/pg_type.h"
 #include "utils/builtins.h"
 #include "utils/date.h"
@@ -12,6 +15,9 @@ extern "C" {
 #include "pgduckdb/pgduckdb_filter.hpp"
 #include "pgduckdb/pgduckdb_detoast.hpp"
 #include "pgduckdb/pgduckdb_types.hpp"
+#include "pgduckdb/scan/postgres_scan.hpp"
+
+#include <cmath>
 
 namespace pgduckdb {
 
@@ -21,6 +27,42 @@ TemplatedFilterOperation(T value, const duckdb::Value &constant) {
 	return OP::Operation(value, constant.GetValueUnsafe<T>());
 }
 
+/*
+ * Read the text of a string Datum into a string_view, detoasting it when
+ * needed. When slice_length is not negative only that many bytes of the text
+ * are needed to evaluate the filter, so only that prefix of a compressed or
+ * on-disk value is decompressed or fetched. bpchar values always need the
+ * whole value to strip their padding. Returns true when the detoasted copy
+ * has to be freed by the caller.
+ */
+static bool
+FilterDatumString(Datum value, bool is_bpchar, int32 slice_length, std::string_view &text, varlena *&detoasted_value) {
+	auto attr = reinterpret_cast<varlena *>(value);
+	bool should_free = false;
+	if (!is_bpchar && slice_length >= 0 && (VARATT_IS_EXTERNAL(attr) || VARATT_IS_COMPRESSED(attr))) {
+		detoasted_value = reinterpret_cast<varlena *>(DetoastPostgresDatumSlice(attr, slice_length, &should_free));
+		auto len = std::min<size_t>(VARSIZE_ANY_EXHDR(detoasted_value), slice_length);
+		text = std::string_view((const char *)VARDATA_ANY(detoasted_value), len);
+		return should_free;
+	}
+
+	detoasted_value = reinterpret_cast<varlena *>(DetoastPostgresDatum(attr, &should_free));
+	/* bpchar adds zero padding so we need to read true len of bpchar */
+	auto len = is_bpchar ? bpchartruelen(VARDATA_ANY(detoasted_value), VARSIZE_ANY_EXHDR(detoasted_value))
+	                     : VARSIZE_ANY_EXHDR(detoasted_value);
+	text = std::string_view((const char *)VARDATA_ANY(detoasted_value), len);
+	return should_free;
+}
+
+/*
+ * Length of the text of a string Datum, without detoasting it. Only exact for
+ * types that are not padded.
+ */
+static inline size_t
+FilterDatumStringLength(Datum value) {
+	return PostgresDatumRawDataSize(reinterpret_cast<varlena *>(value));
+}
+
 template <class OP>
 bool
 StringFilterOperation(Datum &value, const duckdb::Value &constant, bool is_bpchar) {
@@ -28,16 +70,16 @@ StringFilterOperation(Datum &value, const duckdb::Value &constant, bool is_bpcha
 		return false; // Comparison to NULL always returns false.
 	}
 
-	bool should_free = false;
-	const auto detoasted_value = DetoastPostgresDatum(reinterpret_cast<varlena *>(value), &should_free);
-
-	/* bpchar adds zero padding so we need to read true len of bpchar */
-	auto detoasted_val_len = is_bpchar ? bpchartruelen(VARDATA_ANY(detoasted_value), VARSIZE_ANY_EXHDR(detoasted_value))
-	                                   : VARSIZE_ANY_EXHDR(detoasted_value);
-
-	const auto datum_sv = std::string_view((const char *)VARDATA_ANY(detoasted_value), detoasted_val_len);
 	const auto val = duckdb::StringValue::Get(constant);
 	const auto val_sv = std::string_view(val);
+	if (std::is_same<OP, duckdb::Equals>::value && !is_bpchar && FilterDatumStringLength(value) != val_sv.size()) {
+		return false;
+	}
+
+	/* One byte more than the constant decides every comparison with it */
+	std::string_view datum_sv;
+	varlena *detoasted_value;
+	bool should_free = FilterDatumString(value, is_bpchar, val_sv.size() + 1, datum_sv, detoasted_value);
 	const bool res = OP::Operation(datum_sv, val_sv);
 
 	if (should_free) {
@@ -111,18 +153,684 @@ ApplyValueFilter(duckdb::TableFilter &filter, Datum &value, bool is_null, Oid ty
 		case duckdb::ExpressionType::COMPARE_GREATERTHANOREQUALTO:
 			return FilterOperationSwitch<duckdb::GreaterThanEquals>(value, constant_filter.constant, type_oid);
 		default:
-			D_ASSERT(0);
+			/* Keep the value, DuckDB applies the comparisons the scan does not know itself */
+			return true;
 		}
-		break;
+	}
+	case duckdb::TableFilterType::CONJUNCTION_OR: {
+		auto &conjunction = filter.Cast<duckdb::ConjunctionOrFilter>();
+		for (auto &child_filter : conjunction.child_filters) {
+			if (ApplyValueFilter(*child_filter, value, is_null, type_oid)) {
+				return true;
+			}
+		}
+		return false;
+	}
+	case duckdb::TableFilterType::OPTIONAL_FILTER: {
+		/* Optional filters are also evaluated by DuckDB, applying them here only discards rows earlier */
+		auto &optional_filter = filter.Cast<duckdb::OptionalFilter>();
+		return ApplyValueFilter(*optional_filter.child_filter, value, is_null, type_oid);
 	}
 	case duckdb::TableFilterType::IS_NOT_NULL:
 		return is_null == false;
 	case duckdb::TableFilterType::IS_NULL:
 		return is_null == true;
 	default:
-		D_ASSERT(0);
+		/* Same for filter types the scan does not know */
+		return true;
+	}
+}
+
+/*
+ * Read a Datum as the value DuckDB compares the filter constant with. K is
+ * the type IN-list values are stored as.
+ */
+struct FilterDatumBool {
+	using T = bool;
+	using K = int64_t;
+	static T
+	Get(Datum value) {
+		return DatumGetBool(value);
+	}
+};
+
+struct FilterDatumChar {
+	using T = uint8_t;
+	using K = int64_t;
+	static T
+	Get(Datum value) {
+		return DatumGetChar(value);
+	}
+};
+
+struct FilterDatumInt16 {
+	using T = int16_t;
+	using K = int64_t;
+	static T
+	Get(Datum value) {
+		return DatumGetInt16(value);
+	}
+};
+
+struct FilterDatumInt32 {
+	using T = int32_t;
+	using K = int64_t;
+	static T
+	Get(Datum value) {
+		return DatumGetInt32(value);
+	}
+};
+
+struct FilterDatumInt64 {
+	using T = int64_t;
+	using K = int64_t;
+	static T
+	Get(Datum value) {
+		return DatumGetInt64(value);
+	}
+};
+
+struct FilterDatumFloat4 {
+	using T = float;
+	using K = double;
+	static T
+	Get(Datum value) {
+		return DatumGetFloat4(value);
+	}
+};
+
+struct FilterDatumFloat8 {
+	using T = double;
+	using K = double;
+	static T
+	Get(Datum value) {
+		return DatumGetFloat8(value);
+	}
+};
+
+struct FilterDatumDate {
+	using T = int32_t;
+	using K = int64_t;
+	static T
+	Get(Datum value) {
+		return DatumGetDateADT(value) + pgduckdb::PGDUCKDB_DUCK_DATE_OFFSET;
+	}
+};
+
+struct FilterDatumTimestamp {
+	using T = int64_t;
+	using K = int64_t;
+	static T
+	Get(Datum value) {
+		return DatumGetTimestamp(value) + pgduckdb::PGDUCKDB_DUCK_TIMESTAMP_OFFSET;
+	}
+};
+
+template <class GET, class OP>
+static int
+SelectComparison(const PostgresScanFilterKernel &kernel, const Datum *values, const bool *nulls, const bool *walked,
+                 uint16_t *sel, int count) {
+	const auto constant = kernel.constant.GetValueUnsafe<typename GET::T>();
+	int nselected = 0;
+	for (int i = 0; i < count; i++) {
+		auto row = sel[i];
+		bool is_null = walked[row] && nulls[row];
+		sel[nselected] = row;
+		nselected += !is_null && OP::Operation(GET::Get(values[row]), constant);
+	}
+	return nselected;
+}
+
+template <class OP>
+static int
+SelectStringComparison(const PostgresScanFilterKernel &kernel, const Datum *values, const bool *nulls,
+                       const bool *walked, uint16_t *sel, int count) {
+	const auto constant = std::string_view(kernel.constant_string);
+	bool is_bpchar = kernel.type_oid == BPCHAROID;
+	int nselected = 0;
+	for (int i = 0; i < count; i++) {
+		auto row = sel[i];
+		if (walked[row] && nulls[row]) {
+			continue;
+		}
+
+		if (std::is_same<OP, duckdb::Equals>::value && !is_bpchar &&
+		    FilterDatumStringLength(values[row]) != constant.size()) {
+			continue;
+		}
+
+		std::string_view text;
+		varlena *detoasted_value;
+		bool should_free = FilterDatumString(values[row], is_bpchar, kernel.slice_length, text, detoasted_value);
+		const bool res = OP::Operation(text, constant);
+		if (should_free) {
+			duckdb_free(reinterpret_cast<void *>(detoasted_value));
+		}
+		if (res) {
+			sel[nselected++] = row;
+		}
+	}
+	return nselected;
+}
+
+static int
+SelectNone(const PostgresScanFilterKernel &, const Datum *, const bool *, const bool *, uint16_t *, int) {
+	return 0;
+}
+
+template <bool IS_NULL>
+static int
+SelectNullness(const PostgresScanFilterKernel &, const Datum *, const bool *nulls, const bool *walked, uint16_t *sel,
+               int count) {
+	int nselected = 0;
+	for (int i = 0; i < count; i++) {
+		auto row = sel[i];
+		bool is_null = walked[row] && nulls[row];
+		sel[nselected] = row;
+		nselected += is_null == IS_NULL;
+	}
+	return nselected;
+}
+
+/* Filters that have no typed kernel are evaluated per value by ApplyValueFilter */
+static int
+SelectApplyValueFilter(const PostgresScanFilterKernel &kernel, const Datum *values, const bool *nulls,
+                       const bool *walked, uint16_t *sel, int count) {
+	int nselected = 0;
+	for (int i = 0; i < count; i++) {
+		auto row = sel[i];
+		Datum value = values[row];
+		if (ApplyValueFilter(*kernel.filter, value, walked[row] && nulls[row], kernel.type_oid)) {
+			sel[nselected++] = row;
+		}
+	}
+	return nselected;
+}
+
+/* IN-lists up to this length are searched linearly, longer ones through a hash set */
+#define IN_LIST_HASH_THRESHOLD 8
+
+template <class K>
+static const duckdb::vector<K> &InListValues(const PostgresScanFilterKernel &kernel);
+template <class K>
+static const duckdb::unordered_set<K> &InListSet(const PostgresScanFilterKernel &kernel);
+
+template <>
+const duckdb::vector<int64_t> &
+InListValues<int64_t>(const PostgresScanFilterKernel &kernel) {
+	return kernel.in_ints;
+}
+
+template <>
+const duckdb::vector<double> &
+InListValues<double>(const PostgresScanFilterKernel &kernel) {
+	return kernel.in_doubles;
+}
+
+template <>
+const duckdb::unordered_set<int64_t> &
+InListSet<int64_t>(const PostgresScanFilterKernel &kernel) {
+	return kernel.in_int_set;
+}
+
+template <>
+const duckdb::unordered_set<double> &
+InListSet<double>(const PostgresScanFilterKernel &kernel) {
+	return kernel.in_double_set;
+}
+
+/* Postgres' float equality (float8_eq) treats NaN as equal to NaN, unlike == */
+template <class K>
+static inline bool
+InListIsNaN(K key) {
+	return false;
+}
+
+template <>
+inline bool
+InListIsNaN<double>(double key) {
+	return std::isnan(key);
+}
+
+template <class GET, bool USE_SET>
+static int
+SelectInList(const PostgresScanFilterKernel &kernel, const Datum *values, const bool *nulls, const bool *walked,
+             uint16_t *sel, int count) {
+	using K = typename GET::K;
+	const auto &list = InListValues<K>(kernel);
+	const auto &set = InListSet<K>(kernel);
+	int nselected = 0;
+	for (int i = 0; i < count; i++) {
+		auto row = sel[i];
+		if (walked[row] && nulls[row]) {
+			continue;
+		}
+		K key = GET::Get(values[row]);
+		bool found = false;
+		if (InListIsNaN(key)) {
+			found = kernel.in_nan;
+		} else if (USE_SET) {
+			found = set.find(key) != set.end();
+		} else {
+			for (auto value : list) {
+				found |= value == key;
+			}
+		}
+		sel[nselected] = row;
+		nselected += found;
+	}
+	return nselected;
+}
+
+template <bool USE_SET>
+static int
+SelectStringInList(const PostgresScanFilterKernel &kernel, const Datum *values, const bool *nulls,
+                   const bool *walked, uint16_t *sel, int count) {
+	bool is_bpchar = kernel.type_oid == BPCHAROID;
+	int nselected = 0;
+	for (int i = 0; i < count; i++) {
+		auto row = sel[i];
+		if (walked[row] && nulls[row]) {
+			continue;
+		}
+
+		if (!is_bpchar && FilterDatumStringLength(values[row]) >= (size_t)kernel.slice_length) {
+			/* Longer than every value of the list */
+			continue;
+		}
+
+		std::string_view text;
+		varlena *detoasted_value;
+		bool should_free = FilterDatumString(values[row], is_bpchar, kernel.slice_length, text, detoasted_value);
+		bool found = false;
+		if (USE_SET) {
+			found = kernel.in_string_set.find(text) != kernel.in_string_set.end();
+		} else {
+			for (const auto &value : kernel.in_strings) {
+				if (text == value) {
+					found = true;
+					break;
+				}
+			}
+		}
+		if (should_free) {
+			duckdb_free(reinterpret_cast<void *>(detoasted_value));
+		}
+		if (found) {
+			sel[nselected++] = row;
+		}
+	}
+	return nselected;
+}
+
+/* A string range [prefix, prefix with the last byte incremented) fused into one prefix check */
+static int
+SelectStringPrefix(const PostgresScanFilterKernel &kernel, const Datum *values, const bool *nulls, const bool *walked,
+                   uint16_t *sel, int count) {
+	const auto prefix = std::string_view(kernel.constant_string);
+	bool is_bpchar = kernel.type_oid == BPCHAROID;
+	int nselected = 0;
+	for (int i = 0; i < count; i++) {
+		auto row = sel[i];
+		if (walked[row] && nulls[row]) {
+			continue;
+		}
+
+		if (!is_bpchar && FilterDatumStringLength(values[row]) < prefix.size()) {
+			continue;
+		}
+
+		std::string_view text;
+		varlena *detoasted_value;
+		bool should_free = FilterDatumString(values[row], is_bpchar, kernel.slice_length, text, detoasted_value);
+		bool res = text.size() >= prefix.size() && memcmp(text.data(), prefix.data(), prefix.size()) == 0;
+		if (should_free) {
+			duckdb_free(reinterpret_cast<void *>(detoasted_value));
+		}
+		if (res) {
+			sel[nselected++] = row;
+		}
+	}
+	return nselected;
+}
+
+/*
+ * A row passes an OR when it passes any of the alternatives. Every
+ * alternative only looks at the rows none of the previous ones accepted.
+ */
+static int
+SelectOr(const PostgresScanFilterKernel &kernel, const Datum *values, const bool *nulls, const bool *walked,
+         uint16_t *sel, int count) {
+	bool accepted[PGDUCKDB_SCAN_BATCH_SIZE];
+	uint16_t remaining[PGDUCKDB_SCAN_BATCH_SIZE];
+	uint16_t child_sel[PGDUCKDB_SCAN_BATCH_SIZE];
+	int nremaining = count;
+
+	for (int i = 0; i < count; i++) {
+		accepted[sel[i]] = false;
+		remaining[i] = sel[i];
+	}
+
+	for (const auto &child : kernel.or_children) {
+		memcpy(child_sel, remaining, sizeof(uint16_t) * nremaining);
+		int nchild = child->Select(values, nulls, walked, child_sel, nremaining);
+		if (nchild == 0) {
+			continue;
+		}
+		for (int i = 0; i < nchild; i++) {
+			accepted[child_sel[i]] = true;
+		}
+		int nleft = 0;
+		for (int i = 0; i < nremaining; i++) {
+			remaining[nleft] = remaining[i];
+			nleft += !accepted[remaining[i]];
+		}
+		nremaining = nleft;
+		if (nremaining == 0) {
+			break;
+		}
+	}
+
+	int nselected = 0;
+	for (int i = 0; i < count; i++) {
+		sel[nselected] = sel[i];
+		nselected += accepted[sel[i]];
+	}
+	return nselected;
+}
+
+template <bool USE_SET>
+static PostgresScanFilterKernel::SelectFunction
+InListKernel(Oid type_oid) {
+	switch (type_oid) {
+	case BOOLOID:
+		return SelectInList<FilterDatumBool, USE_SET>;
+	case CHAROID:
+		return SelectInList<FilterDatumChar, USE_SET>;
+	case INT2OID:
+		return SelectInList<FilterDatumInt16, USE_SET>;
+	case INT4OID:
+		return SelectInList<FilterDatumInt32, USE_SET>;
+	case INT8OID:
+		return SelectInList<FilterDatumInt64, USE_SET>;
+	case FLOAT4OID:
+		return SelectInList<FilterDatumFloat4, USE_SET>;
+	case FLOAT8OID:
+		return SelectInList<FilterDatumFloat8, USE_SET>;
+	case DATEOID:
+		return SelectInList<FilterDatumDate, USE_SET>;
+	case TIMESTAMPOID:
+	case TIMESTAMPTZOID:
+		return SelectInList<FilterDatumTimestamp, USE_SET>;
+	case BPCHAROID:
+	case TEXTOID:
+	case VARCHAROID:
+		return SelectStringInList<USE_SET>;
+	default:
+		return nullptr;
+	}
+}
+
+/* Store an IN-list constant the way the kernel of the column type compares it */
+static void
+AddInListValue(PostgresScanFilterKernel &kernel, const duckdb::Value &constant) {
+	switch (kernel.type_oid) {
+	case BOOLOID:
+		kernel.in_ints.push_back(constant.GetValueUnsafe<bool>());
+		break;
+	case CHAROID:
+		kernel.in_ints.push_back(constant.GetValueUnsafe<uint8_t>());
+		break;
+	case INT2OID:
+		kernel.in_ints.push_back(constant.GetValueUnsafe<int16_t>());
+		break;
+	case INT4OID:
+	case DATEOID:
+		kernel.in_ints.push_back(constant.GetValueUnsafe<int32_t>());
+		break;
+	case INT8OID:
+	case TIMESTAMPOID:
+	case TIMESTAMPTZOID:
+		kernel.in_ints.push_back(constant.GetValueUnsafe<int64_t>());
+		break;
+	case FLOAT4OID:
+	case FLOAT8OID: {
+		double value =
+		    kernel.type_oid == FLOAT4OID ? constant.GetValueUnsafe<float>() : constant.GetValueUnsafe<double>();
+		if (std::isnan(value)) {
+			kernel.in_nan = true;
+		} else {
+			kernel.in_doubles.push_back(value);
+		}
+		break;
+	}
+	default:
+		kernel.in_strings.push_back(duckdb::StringValue::Get(constant));
+		break;
+	}
+}
+
+template <class OP>
+static PostgresScanFilterKernel::SelectFunction
+ComparisonKernel(Oid type_oid) {
+	switch (type_oid) {
+	case BOOLOID:
+		return SelectComparison<FilterDatumBool, OP>;
+	case CHAROID:
+		return SelectComparison<FilterDatumChar, OP>;
+	case INT2OID:
+		return SelectComparison<FilterDatumInt16, OP>;
+	case INT4OID:
+		return SelectComparison<FilterDatumInt32, OP>;
+	case INT8OID:
+		return SelectComparison<FilterDatumInt64, OP>;
+	case FLOAT4OID:
+		return SelectComparison<FilterDatumFloat4, OP>;
+	case FLOAT8OID:
+		return SelectComparison<FilterDatumFloat8, OP>;
+	case DATEOID:
+		return SelectComparison<FilterDatumDate, OP>;
+	case TIMESTAMPOID:
+	case TIMESTAMPTZOID:
+		return SelectComparison<FilterDatumTimestamp, OP>;
+	case BPCHAROID:
+	case TEXTOID:
+	case VARCHAROID:
+		return SelectStringComparison<OP>;
+	default:
+		return nullptr;
+	}
+}
+
+PostgresScanColumnFilter::PostgresScanColumnFilter(duckdb::TableFilter &filter, Oid type_oid, int value_idx)
+    : m_value_idx(value_idx) {
+	Compile(filter, type_oid);
+	FusePrefixRanges();
+}
+
+/*
+ * Flatten the filter into a chain of kernels that all have to pass. The type
+ * and comparison are resolved here once, instead of for every value.
+ */
+void
+PostgresScanColumnFilter::Compile(duckdb::TableFilter &filter, Oid type_oid) {
+	auto kernel = duckdb::make_uniq<PostgresScanFilterKernel>();
+	kernel->filter = &filter;
+	kernel->type_oid = type_oid;
+
+	switch (filter.filter_type) {
+	case duckdb::TableFilterType::CONJUNCTION_AND: {
+		auto &conjunction = filter.Cast<duckdb::ConjunctionAndFilter>();
+		for (auto &child_filter : conjunction.child_filters) {
+			Compile(*child_filter, type_oid);
+		}
+		return;
+	}
+	case duckdb::TableFilterType::CONJUNCTION_OR: {
+		auto &conjunction = filter.Cast<duckdb::ConjunctionOrFilter>();
+		if (CompileInList(conjunction, type_oid)) {
+			return;
+		}
+		for (auto &child_filter : conjunction.child_filters) {
+			kernel->or_children.push_back(
+			    duckdb::make_uniq<PostgresScanColumnFilter>(*child_filter, type_oid, m_value_idx));
+		}
+		kernel->select = SelectOr;
+		break;
+	}
+	case duckdb::TableFilterType::OPTIONAL_FILTER: {
+		/* DuckDB evaluates optional filters itself as well, applying them here only discards rows earlier */
+		auto &optional_filter = filter.Cast<duckdb::OptionalFilter>();
+		Compile(*optional_filter.child_filter, type_oid);
+		return;
+	}
+	case duckdb::TableFilterType::CONSTANT_COMPARISON: {
+		auto &constant_filter = filter.Cast<duckdb::ConstantFilter>();
+		kernel->comparison = constant_filter.comparison_type;
+		kernel->constant = constant_filter.constant;
+		switch (constant_filter.comparison_type) {
+		case duckdb::ExpressionType::COMPARE_EQUAL:
+			kernel->select = ComparisonKernel<duckdb::Equals>(type_oid);
+			break;
+		case duckdb::ExpressionType::COMPARE_LESSTHAN:
+			kernel->select = ComparisonKernel<duckdb::LessThan>(type_oid);
+			break;
+		case duckdb::ExpressionType::COMPARE_LESSTHANOREQUALTO:
+			kernel->select = ComparisonKernel<duckdb::LessThanEquals>(type_oid);
+			break;
+		case duckdb::ExpressionType::COMPARE_GREATERTHAN:
+			kernel->select = ComparisonKernel<duckdb::GreaterThan>(type_oid);
+			break;
+		case duckdb::ExpressionType::COMPARE_GREATERTHANOREQUALTO:
+			kernel->select = ComparisonKernel<duckdb::GreaterThanEquals>(type_oid);
+			break;
+		default:
+			break;
+		}
+		if (kernel->select && kernel->constant.IsNull()) {
+			/* Comparison to NULL is never true */
+			kernel->select = SelectNone;
+		} else if (kernel->select && kernel->constant.type().InternalType() == duckdb::PhysicalType::VARCHAR) {
+			kernel->constant_string = duckdb::StringValue::Get(kernel->constant);
+			/* One byte more than the constant decides every comparison with it */
+			kernel->slice_length = kernel->constant_string.size() + 1;
+		}
+		break;
+	}
+	case duckdb::TableFilterType::IS_NOT_NULL:
+		kernel->select = SelectNullness<false>;
+		break;
+	case duckdb::TableFilterType::IS_NULL:
+		kernel->select = SelectNullness<true>;
+		break;
+	default:
 		break;
 	}
+
+	if (!kernel->select) {
+		kernel->select = SelectApplyValueFilter;
+	}
+	m_kernels.push_back(std::move(kernel));
+}
+
+/*
+ * An OR of equality comparisons with constants, which is how DuckDB pushes
+ * down IN-lists, becomes a single IN-list kernel. Returns false when the OR
+ * has another shape or the column type has no IN-list kernel.
+ */
+bool
+PostgresScanColumnFilter::CompileInList(duckdb::ConjunctionOrFilter &filter, Oid type_oid) {
+	bool use_set = filter.child_filters.size() > IN_LIST_HASH_THRESHOLD;
+	auto select = use_set ? InListKernel<true>(type_oid) : InListKernel<false>(type_oid);
+	if (!select) {
+		return false;
+	}
+
+	for (auto &child_filter : filter.child_filters) {
+		if (child_filter->filter_type != duckdb::TableFilterType::CONSTANT_COMPARISON) {
+			return false;
+		}
+		auto &constant_filter = child_filter->Cast<duckdb::ConstantFilter>();
+		if (constant_filter.comparison_type != duckdb::ExpressionType::COMPARE_EQUAL) {
+			return false;
+		}
+	}
+
+	auto kernel = duckdb::make_uniq<PostgresScanFilterKernel>();
+	kernel->filter = &filter;
+	kernel->type_oid = type_oid;
+	kernel->select = select;
+	for (auto &child_filter : filter.child_filters) {
+		auto &constant = child_filter->Cast<duckdb::ConstantFilter>().constant;
+		/* x = NULL never matches, so the value can be left out of the list */
+		if (!constant.IsNull()) {
+			AddInListValue(*kernel, constant);
+		}
+	}
+
+	kernel->slice_length = 0;
+	for (const auto &value : kernel->in_strings) {
+		kernel->slice_length = std::max<int32>(kernel->slice_length, value.size() + 1);
+	}
+
+	if (use_set) {
+		kernel->in_int_set.insert(kernel->in_ints.begin(), kernel->in_ints.end());
+		kernel->in_double_set.insert(kernel->in_doubles.begin(), kernel->in_doubles.end());
+		/* The views point into in_strings, which is not modified anymore */
+		for (const auto &value : kernel->in_strings) {
+			kernel->in_string_set.insert(std::string_view(value));
+		}
+	}
+
+	m_kernels.push_back(std::move(kernel));
+	return true;
+}
+
+/*
+ * Replace a pair of string comparisons x >= 'abc' AND x < 'abd', the range a
+ * prefix match is pushed down as, by a single prefix check.
+ */
+void
+PostgresScanColumnFilter::FusePrefixRanges() {
+	for (auto &lower : m_kernels) {
+		if (!lower || lower->comparison != duckdb::ExpressionType::COMPARE_GREATERTHANOREQUALTO ||
+		    lower->constant_string.empty()) {
+			continue;
+		}
+		auto upper_bound = lower->constant_string;
+		if ((unsigned char)upper_bound.back() == 0xFF) {
+			continue;
+		}
+		upper_bound.back() = (char)((unsigned char)upper_bound.back() + 1);
+
+		for (auto &upper : m_kernels) {
+			if (upper && upper != lower && upper->comparison == duckdb::ExpressionType::COMPARE_LESSTHAN &&
+			    upper->select != SelectNone && upper->constant_string == upper_bound) {
+				lower->select = SelectStringPrefix;
+				lower->slice_length = lower->constant_string.size();
+				upper.reset();
+				break;
+			}
+		}
+	}
+
+	m_kernels.erase(std::remove(m_kernels.begin(), m_kernels.end(), nullptr), m_kernels.end());
+}
+
+/*
+ * Narrow the selection of batch rows to those passing every kernel of the
+ * chain. Returns the number of selected rows.
+ */
+int
+PostgresScanColumnFilter::Select(const Datum *values, const bool *nulls, const bool *walked, uint16_t *sel,
+                                 int count) const {
+	for (const auto &kernel : m_kernels) {
+		if (count == 0) {
+			break;
+		}
+		count = kernel->select(*kernel, values, nulls, walked, sel, count);
+	}
+	return count;
 }
 
 } // namespace pgduckdb
@@ -9,11 +9,13 @@ extern "C" {
 #include "utils/ruleutils.h"
 }
 
+#include "pgduckdb/pgduckdb.h"
 #include "pgduckdb/pgduckdb_node.hpp"
 #include "pgduckdb/pgduckdb_types.hpp"
 #include "pgduckdb/pgduckdb_duckdb.hpp"
 #include "pgduckdb/pgduckdb_planner.hpp"
 #include "pgduckdb/pgduckdb_utils.hpp"
+#include "pgduckdb/scan/postgres_parallel_scan.hpp"
 
 /* global variables */
 CustomScanMethods duckdb_scan_scan_methods;
@@ -24,6 +26,10 @@ static CustomExecMethods duckdb_scan_exec_methods;
 typedef struct DuckdbScanState {
 	CustomScanState css; /* must be first field */
 	const Query *query;
+	/* The plan allows parallel workers, see DuckdbPlanNode */
+	bool parallel_safe;
+	/* Postgres scans of the query may launch parallel workers */
+	bool parallel_scans;
 	ParamListInfo params;
 	duckdb::Connection *duckdb_connection;
 	duckdb::PreparedStatement *prepared_statement;
@@ -68,6 +74,7 @@ Duckdb_CreateCustomScanState(CustomScan *cscan) {
 	CustomScanState *custom_scan_state = &duckdb_scan_state->css;
 
 	duckdb_scan_state->query = (const Query *)linitial(cscan->custom_private);
+	duckdb_scan_state->parallel_safe = boolVal(lsecond(cscan->custom_private));
 	custom_scan_state->methods = &duckdb_scan_exec_methods;
 	return (Node *)custom_scan_state;
 }
@@ -83,6 +90,10 @@ Duckdb_BeginCustomScan(CustomScanState *cscanstate, EState *estate, int eflags)
 		elog(ERROR, "DuckDB re-planning failed %s", prepared_query->GetError().c_str());
 	}
 
+	duckdb_scan_state->parallel_scans =
+	    duckdb_scan_state->parallel_safe && duckdb_postgres_scan_parallel_workers > 0;
+	duckdb_connection->context->config.set_variables[PGDUCKDB_PARALLEL_SCAN_SAFE_SETTING] =
+	    duckdb::Value::BOOLEAN(duckdb_scan_state->parallel_scans);
 	duckdb_scan_state->duckdb_connection = duckdb_connection.release();
 	duckdb_scan_state->prepared_statement = prepared_query.release();
 	duckdb_scan_state->params = estate->es_param_list_info;
@@ -122,7 +133,13 @@ ExecuteQuery(DuckdbScanState *state) {
 		}
 	}
 
-	auto pending = prepared.PendingQuery(duckdb_params, true);
+	/*
+	 * The backend is in parallel mode while workers run, which must end
+	 * before control returns to the portal: it may be suspended and other
+	 * statements of the transaction run meanwhile. Results of queries that
+	 * may launch workers are materialized, so their scans are done here.
+	 */
+	auto pending = prepared.PendingQuery(duckdb_params, !state->parallel_scans);
 	if (pending->HasError()) {
 		return pending->ThrowError();
 	}
@@ -2,7 +2,10 @@
 
 extern "C" {
 #include "postgres.h"
+#include "miscadmin.h"
+#include "access/parallel.h"
 #include "access/xact.h"
+#include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodes.h"
@@ -52,7 +55,7 @@ DuckdbPrepare(const Query *query) {
 }
 
 static Plan *
-CreatePlan(Query *query, bool throw_error) {
+CreatePlan(Query *query, bool parallel_safe, bool throw_error) {
 	int elevel = throw_error ? ERROR : WARNING;
 	/*
 	 * Prepare the query, se we can get the returned types and column names.
@@ -98,7 +101,7 @@ CreatePlan(Query *query, bool throw_error) {
 		ReleaseSysCache(tp);
 	}
 
-	duckdb_node->custom_private = list_make1(query);
+	duckdb_node->custom_private = list_make2(query, makeBoolean(parallel_safe));
 	duckdb_node->methods = &duckdb_scan_scan_methods;
 
 	return (Plan *)duckdb_node;
@@ -107,8 +110,18 @@ CreatePlan(Query *query, bool throw_error) {
 PlannedStmt *
 DuckdbPlanNode(Query *parse, const char *query_string, int cursor_options, ParamListInfo bound_params,
                bool throw_error) {
+	/*
+	 * Postgres table scans of the query may use parallel workers under the
+	 * conditions standard_planner allows a parallel plan, the backend is in
+	 * parallel mode while they run.
+	 */
+	bool parallel_safe = (cursor_options & CURSOR_OPT_PARALLEL_OK) != 0 && IsUnderPostmaster &&
+	                     parse->commandType == CMD_SELECT && !parse->hasModifyingCTE && !IsParallelWorker() &&
+	                     max_parallel_hazard(parse) != PROPARALLEL_UNSAFE;
+
 	/* We need to check can we DuckDB create plan */
-	Plan *plan = pgduckdb::DuckDBFunctionGuard<Plan *>(CreatePlan, "CreatePlan", parse, throw_error);
+	Plan *plan =
+	    pgduckdb::DuckDBFunctionGuard<Plan *>(CreatePlan, "CreatePlan", parse, parallel_safe, throw_error);
 	Plan *duckdb_plan = (Plan *)castNode(CustomScan, plan);
 
 	if (!duckdb_plan) {
@@ -977,160 +977,650 @@ ConvertPostgresToDuckValue(Oid attr_type, Datum value, duckdb::Vector &result, i
 	}
 }
 
-typedef struct HeapTupleReadState {
-	bool m_slow = 0;
-	int m_last_tuple_att = 0;
-	uint32 m_page_tuple_offset = 0;
-} HeapTupleReadState;
-
-static Datum
-HeapTupleFetchNextColumnDatum(TupleDesc tupleDesc, HeapTuple tuple, HeapTupleReadState &heap_tuple_read_state,
-                              int att_num, bool *is_null, const duckdb::map<int, Datum> &missing_attrs) {
-	HeapTupleHeader tup = tuple->t_data;
-	bool hasnulls = HeapTupleHasNulls(tuple);
-	int natts = HeapTupleHeaderGetNatts(tup);
-	int attnum;
-	char *tp;
-	uint32 off;
+/*
+ * Walk the attributes of a tuple from attnum on, starting at offset off, and
+ * store the read columns of row into values/nulls. This is the general
+ * deformer, used for tuples with NULLs and for the part of the row past the
+ * fixed-width prefix. Read columns the tuple is too short to contain get the
+ * attribute missing value, or NULL. Without FILL_NULLS only the values are
+ * stored, which is enough for tuples without NULLs that hold all read columns.
+ */
+template <bool HASNULLS, bool FILL_NULLS = true>
+static inline void
+DeformTupleAttrs(const PostgresScanGlobalState &scan_global_state, HeapTupleHeader tup, int attnum, uint32 off,
+                 Datum *values, bool *nulls, bool *column_has_nulls, int row) {
+	const auto &deform_attrs = scan_global_state.m_deform_attrs;
+	int natts = std::min((int)HeapTupleHeaderGetNatts(tup), (int)deform_attrs.size());
+	char *tp = (char *)tup + tup->t_hoff;
 	bits8 *bp = tup->t_bits;
-	bool slow = false;
-	Datum value = (Datum)0;
+	/* Offsets of the fixed-width prefix can only be used until a NULL or varlena is seen */
+	bool slow = attnum >= scan_global_state.m_deform_fixed_natts;
 
-	if (natts < att_num) {
-		if (auto missing_attr = missing_attrs.find(att_num - 1); missing_attr != missing_attrs.end()) {
-			*is_null = false;
-			return missing_attr->second;
+	for (; attnum < natts; attnum++) {
+		const auto &attr = deform_attrs[attnum];
+
+		if (HASNULLS && att_isnull(attnum, bp)) {
+			if (attr.value_idx >= 0) {
+				values[attr.value_idx * PGDUCKDB_SCAN_BATCH_SIZE + row] = (Datum)0;
+				nulls[attr.value_idx * PGDUCKDB_SCAN_BATCH_SIZE + row] = true;
+				column_has_nulls[attr.value_idx] = true;
+			}
+			slow = true;
+			continue;
+		}
+
+		if (!slow && attr.fixed_offset >= 0) {
+			off = attr.fixed_offset;
+		} else if (attr.attlen == -1) {
+			off = att_align_pointer(off, attr.attalign, -1, tp + off);
+			slow = true;
 		} else {
-			*is_null = true;
-			return PointerGetDatum(NULL);
+			off = att_align_nominal(off, attr.attalign);
 		}
-	}
 
-	attnum = heap_tuple_read_state.m_last_tuple_att;
+		if (attr.value_idx >= 0) {
+			values[attr.value_idx * PGDUCKDB_SCAN_BATCH_SIZE + row] = fetch_att(tp + off, attr.attbyval, attr.attlen);
+			if (FILL_NULLS) {
+				nulls[attr.value_idx * PGDUCKDB_SCAN_BATCH_SIZE + row] = false;
+			}
+		}
 
-	if (attnum == 0) {
-		/* Start from the first attribute */
-		off = 0;
-		heap_tuple_read_state.m_slow = false;
-	} else {
-		/* Restore state from previous execution */
-		off = heap_tuple_read_state.m_page_tuple_offset;
-		slow = heap_tuple_read_state.m_slow;
+		off = att_addlength_pointer(off, attr.attlen, tp + off);
+		if (attr.attlen <= 0) {
+			slow = true;
+		}
 	}
 
-	tp = (char *)tup + tup->t_hoff;
+	if (!FILL_NULLS || natts == (int)deform_attrs.size()) {
+		return;
+	}
 
-	for (; attnum < att_num; attnum++) {
-		Form_pg_attribute thisatt = TupleDescAttr(tupleDesc, attnum);
+	for (const auto &read_column : scan_global_state.m_deform_read_columns) {
+		if (read_column.attnum < natts) {
+			continue;
+		}
+		auto idx = read_column.value_idx * PGDUCKDB_SCAN_BATCH_SIZE + row;
+		values[idx] = read_column.has_missing_value ? read_column.missing_value : (Datum)0;
+		nulls[idx] = !read_column.has_missing_value;
+		column_has_nulls[read_column.value_idx] |= nulls[idx];
+	}
+}
 
-		if (hasnulls && att_isnull(attnum, bp)) {
-			value = (Datum)0;
-			*is_null = true;
-			slow = true; /* can't use attcacheoff anymore */
+/*
+ * Deformer for tuples without NULLs that contain all read columns. Columns in
+ * the fixed-width prefix are fetched at their cached offset, by-value ones
+ * without a filter are skipped entirely as they are read in place when the
+ * batch is converted. Only for the FIXED_PREFIX_VARLENA shape the rest of the
+ * row is walked. The nulls array is not filled in for these rows.
+ */
+template <PostgresScanDeformShape SHAPE>
+static inline void
+DeformTupleNoNulls(const PostgresScanGlobalState &scan_global_state, HeapTupleHeader tup, Datum *values, int row) {
+	const auto &deform_attrs = scan_global_state.m_deform_attrs;
+	char *tp = (char *)tup + tup->t_hoff;
+
+	for (const auto &read_column : scan_global_state.m_deform_read_columns) {
+		const auto &attr = deform_attrs[read_column.attnum];
+		if (SHAPE == PostgresScanDeformShape::FIXED_PREFIX_VARLENA && attr.fixed_offset < 0) {
+			break;
+		}
+		if (read_column.read_in_place) {
 			continue;
 		}
+		values[read_column.value_idx * PGDUCKDB_SCAN_BATCH_SIZE + row] =
+		    fetch_att(tp + attr.fixed_offset, attr.attbyval, attr.attlen);
+	}
 
-		*is_null = false;
+	if (SHAPE == PostgresScanDeformShape::FIXED_PREFIX_VARLENA) {
+		DeformTupleAttrs<false, false>(scan_global_state, tup, scan_global_state.m_deform_fixed_natts,
+		                               scan_global_state.m_deform_fixed_len, values, nullptr, nullptr, row);
+	}
+}
 
-		if (!slow && thisatt->attcacheoff >= 0) {
-			off = thisatt->attcacheoff;
-		} else if (thisatt->attlen == -1) {
-			if (!slow && off == att_align_nominal(off, thisatt->attalign)) {
-				thisatt->attcacheoff = off;
-			} else {
-				off = att_align_pointer(off, thisatt->attalign, -1, tp + off);
-				slow = true;
-			}
+/*
+ * Deform a batch of tuples into the column-major values/nulls arrays. For
+ * every row tuple_data is set to the tuple data when its in place columns can
+ * be read straight from the tuple, or NULL when every column was deformed.
+ */
+template <PostgresScanDeformShape SHAPE>
+static void
+DeformTuples(const PostgresScanGlobalState &scan_global_state, PostgresScanLocalState &scan_local_state,
+             HeapTupleData *tuples, int ntuples) {
+	auto values = scan_local_state.values;
+	auto nulls = scan_local_state.nulls;
+	int natts = scan_global_state.m_deform_attrs.size();
+
+	memset(scan_local_state.column_has_nulls, 0, sizeof(bool) * scan_global_state.m_read_columns_ids.size());
+
+	for (int row = 0; row < ntuples; row++) {
+		HeapTupleHeader tup = tuples[row].t_data;
+		bool no_nulls = !HeapTupleHasNulls(&tuples[row]) && HeapTupleHeaderGetNatts(tup) >= natts;
+
+		if (no_nulls) {
+			DeformTupleNoNulls<SHAPE>(scan_global_state, tup, values, row);
+		} else if (HeapTupleHasNulls(&tuples[row])) {
+			DeformTupleAttrs<true>(scan_global_state, tup, 0, 0, values, nulls, scan_local_state.column_has_nulls,
+			                       row);
 		} else {
-			off = att_align_nominal(off, thisatt->attalign);
-			if (!slow) {
-				thisatt->attcacheoff = off;
-			}
+			DeformTupleAttrs<false>(scan_global_state, tup, 0, 0, values, nulls, scan_local_state.column_has_nulls,
+			                        row);
 		}
 
-		value = fetchatt(thisatt, tp + off);
+		scan_local_state.batch_tuple_data[row] = no_nulls ? (char *)tup + tup->t_hoff : nullptr;
+		scan_local_state.batch_row_walked[row] = !no_nulls;
+	}
+}
+
+/*
+ * Run the compiled column filters over a deformed batch and move the rows
+ * that pass to the front of every batch array. Returns the number of rows
+ * left.
+ */
+static int
+FilterDeformedTuples(const PostgresScanGlobalState &scan_global_state, PostgresScanLocalState &scan_local_state,
+                     int nrows) {
+	auto sel = scan_local_state.batch_sel;
+	int nselected = nrows;
+
+	for (int row = 0; row < nrows; row++) {
+		sel[row] = row;
+	}
+
+	for (const auto &column_filter : scan_global_state.m_column_filters) {
+		auto offset = column_filter.m_value_idx * PGDUCKDB_SCAN_BATCH_SIZE;
+		nselected = column_filter.Select(scan_local_state.values + offset, scan_local_state.nulls + offset,
+		                                 scan_local_state.batch_row_walked, sel, nselected);
+		if (nselected == 0) {
+			return 0;
+		}
+	}
 
-		off = att_addlength_pointer(off, thisatt->attlen, tp + off);
+	if (nselected == nrows) {
+		return nrows;
+	}
 
-		if (thisatt->attlen <= 0) {
-			slow = true;
+	/* Selected rows are ascending, so compacting in place never overwrites a row still to be moved */
+	for (const auto &read_column : scan_global_state.m_deform_read_columns) {
+		auto values = scan_local_state.values + read_column.value_idx * PGDUCKDB_SCAN_BATCH_SIZE;
+		auto nulls = scan_local_state.nulls + read_column.value_idx * PGDUCKDB_SCAN_BATCH_SIZE;
+		for (int i = 0; i < nselected; i++) {
+			values[i] = values[sel[i]];
+			nulls[i] = nulls[sel[i]];
+		}
+	}
+	for (int i = 0; i < nselected; i++) {
+		scan_local_state.batch_tuple_data[i] = scan_local_state.batch_tuple_data[sel[i]];
+		scan_local_state.batch_row_walked[i] = scan_local_state.batch_row_walked[sel[i]];
+	}
+	if (scan_global_state.m_emit_rowid) {
+		for (int i = 0; i < nselected; i++) {
+			scan_local_state.batch_rowids[i] = scan_local_state.batch_rowids[sel[i]];
 		}
 	}
 
-	heap_tuple_read_state.m_last_tuple_att = att_num;
-	heap_tuple_read_state.m_page_tuple_offset = off;
+	return nselected;
+}
 
-	if (slow) {
-		heap_tuple_read_state.m_slow = true;
-	} else {
-		heap_tuple_read_state.m_slow = false;
+#ifndef WORDS_BIGENDIAN
+/*
+ * Pack 8 bools into a byte with the first bool in the lowest bit. Only the
+ * low bit of every byte is kept, the multiplication then shifts the bit of
+ * byte i to bit 56 + i without carries, so the packed bits end up in the top
+ * byte.
+ */
+static inline uint64_t
+PackBools(const bool *bools) {
+	uint64_t bytes;
+	memcpy(&bytes, bools, sizeof(bytes));
+	bytes &= UINT64CONST(0x0101010101010101);
+	return (bytes * UINT64CONST(0x0102040810204080)) >> 56;
+}
+#else
+static inline uint64_t
+PackBools(const bool *bools) {
+	uint64_t packed = 0;
+	for (int i = 0; i < 8; i++) {
+		packed |= (uint64_t)(((const uint8_t *)bools)[i] & 1) << i;
+	}
+	return packed;
+}
+#endif
+
+/* Pack 64 bools into one word, rows past the batch end are read but masked off by the caller */
+static inline uint64_t
+PackBoolsWord(const bool *bools) {
+	uint64_t word = 0;
+	for (int i = 0; i < 8; i++) {
+		word |= PackBools(bools + i * 8) << (i * 8);
 	}
+	return word;
+}
 
-	return value;
+/*
+ * Build the validity of a batch column in bulk. The nulls of the column are
+ * packed 64 rows at a time into a word, masked with the rows that were
+ * walked (only those can be NULL and have their nulls filled in), and cleared
+ * from the validity words of the output vector at the batch offset.
+ */
+static void
+SetColumnValidity(const bool *nulls, const uint64_t *walked_rows, int nrows, duckdb::Vector &result, idx_t offset) {
+	auto &validity = duckdb::FlatVector::Validity(result);
+	duckdb::validity_t *mask = nullptr;
+	const int bits_per_word = sizeof(duckdb::validity_t) * 8;
+
+	for (int word_idx = 0; word_idx * bits_per_word < nrows; word_idx++) {
+		int first_row = word_idx * bits_per_word;
+		uint64_t null_bits = PackBoolsWord(nulls + first_row) & walked_rows[word_idx];
+		if (nrows - first_row < bits_per_word) {
+			null_bits &= (UINT64CONST(1) << (nrows - first_row)) - 1;
+		}
+		if (null_bits == 0) {
+			continue;
+		}
+
+		idx_t position = offset + first_row;
+		if (!mask) {
+			/* Allocates the validity buffer if the vector had no NULLs yet */
+			validity.SetInvalid(position + __builtin_ctzll(null_bits));
+			mask = validity.GetData();
+		}
+		idx_t entry = position / bits_per_word;
+		idx_t shift = position % bits_per_word;
+		mask[entry] &= ~(null_bits << shift);
+		if (shift && (null_bits >> (bits_per_word - shift))) {
+			mask[entry + 1] &= ~(null_bits >> (bits_per_word - shift));
+		}
+	}
 }
 
-void
-InsertTupleIntoChunk(duckdb::DataChunk &output, duckdb::shared_ptr<PostgresScanGlobalState> scan_global_state,
-                     duckdb::shared_ptr<PostgresScanLocalState> scan_local_state, HeapTupleData *tuple) {
-	HeapTupleReadState heap_tuple_read_state = {};
+/*
+ * One read column of a decoded batch. Rows for which tuple_data is set have
+ * no NULLs and the column value is read in place at fixed_offset, for the
+ * other rows the deformed value is in values. NULL rows have a zero value, so
+ * the typed loops can convert them like any other row; their validity is set
+ * separately when has_nulls is set.
+ */
+struct DecodedColumn {
+	const Datum *values;
+	char *const *tuple_data;
+	int fixed_offset;
+	int nrows;
+	bool has_nulls;
+};
 
-	if (scan_global_state->m_count_tuples_only) {
-		scan_local_state->m_output_vector_size++;
+static inline Datum
+DecodedColumnDatum(const DecodedColumn &column, int16 attlen, int row) {
+	if (column.fixed_offset >= 0 && column.tuple_data[row]) {
+		return fetch_att(column.tuple_data[row] + column.fixed_offset, true, attlen);
+	}
+	return column.values[row];
+}
+
+template <class T, int ATTLEN, class OP>
+static void
+AppendFixedWidthColumn(const DecodedColumn &column, duckdb::Vector &result, idx_t offset, OP convert) {
+	auto data = duckdb::FlatVector::GetData<T>(result) + offset;
+
+	if (column.fixed_offset >= 0) {
+		/* Strided copy out of the tuples, only rows with NULLs were deformed */
+		for (int row = 0; row < column.nrows; row++) {
+			const char *tp = column.tuple_data[row];
+			data[row] = convert(tp ? fetch_att(tp + column.fixed_offset, true, ATTLEN) : column.values[row]);
+		}
 		return;
 	}
 
-	auto values = scan_local_state->values;
-	auto nulls = scan_local_state->nulls;
-
-	/* First we are fetching all required columns ordered by column id
-	 * and than we need to write this tuple into output vector. Output column id list
-	 * could be out of order so we need to match column values from ordered list.
-	 */
-
-	/* Read heap tuple with all required columns. */
-	for (auto const &[columnIdx, valueIdx] : scan_global_state->m_read_columns_ids) {
-		values[valueIdx] =
-		    HeapTupleFetchNextColumnDatum(scan_global_state->m_tuple_desc, tuple, heap_tuple_read_state, columnIdx + 1,
-		                                  &nulls[valueIdx], scan_global_state->m_relation_missing_attrs);
-		if (scan_global_state->m_filters &&
-		    (scan_global_state->m_filters->filters.find(valueIdx) != scan_global_state->m_filters->filters.end())) {
-			auto &filter = scan_global_state->m_filters->filters[valueIdx];
-			const auto valid_tuple = ApplyValueFilter(*filter, values[valueIdx], nulls[valueIdx],
-			                               scan_global_state->m_tuple_desc->attrs[columnIdx].atttypid);
-			if (!valid_tuple) {
-				return;
+	for (int row = 0; row < column.nrows; row++) {
+		data[row] = convert(column.values[row]);
+	}
+}
+
+/*
+ * Store the text values of a batch column as strings that point into the
+ * page, instead of copying them into the string heap of the vector. Toasted
+ * values are still detoasted and copied. The page pins are attached to the
+ * vector so the page outlives the strings.
+ */
+static void
+AppendStringColumnNoCopy(const FormData_pg_attribute &attr, const DecodedColumn &column, duckdb::Vector &result,
+                         idx_t offset, const duckdb::buffer_ptr<duckdb::VectorBuffer> &page_pins) {
+	auto data = duckdb::FlatVector::GetData<duckdb::string_t>(result) + offset;
+	auto &validity = duckdb::FlatVector::Validity(result);
+	bool is_bpchar = attr.atttypid == BPCHAROID;
+
+	for (int row = 0; row < column.nrows; row++) {
+		if (column.has_nulls && !validity.RowIsValid(offset + row)) {
+			continue;
+		}
+		Datum value = column.values[row];
+		if (VARATT_IS_EXTENDED(DatumGetPointer(value)) && !VARATT_IS_SHORT(DatumGetPointer(value))) {
+			bool should_free = false;
+			value = DetoastPostgresDatum(reinterpret_cast<varlena *>(value), &should_free);
+			ConvertPostgresToDuckValue(attr.atttypid, value, result, offset + row);
+			if (should_free) {
+				duckdb_free(reinterpret_cast<void *>(value));
 			}
+			continue;
 		}
+		const char *text = VARDATA_ANY(value);
+		auto len = is_bpchar ? bpchartruelen(VARDATA_ANY(value), VARSIZE_ANY_EXHDR(value)) : VARSIZE_ANY_EXHDR(value);
+		data[row] = duckdb::string_t(text, len);
+	}
 
+	duckdb::StringVector::AddBuffer(result, page_pins);
+}
+
+/*
+ * Add the text values of a batch column to the dictionary of the chunk.
+ * Returns the number of rows added, which is less than the batch size when
+ * the dictionary overflowed.
+ */
+static int
+AppendStringColumnDictionary(const FormData_pg_attribute &attr, const DecodedColumn &column,
+                             const duckdb::Vector &result, idx_t offset, PostgresScanStringDictionary &dictionary) {
+	auto &validity = duckdb::FlatVector::Validity(result);
+	bool is_bpchar = attr.atttypid == BPCHAROID;
+
+	for (int row = 0; row < column.nrows; row++) {
+		if (column.has_nulls && !validity.RowIsValid(offset + row)) {
+			if (!dictionary.AddNull(offset + row)) {
+				return row;
+			}
+			continue;
+		}
+
+		bool should_free = false;
+		Datum value = column.values[row];
+		if (VARATT_IS_EXTENDED(DatumGetPointer(value)) && !VARATT_IS_SHORT(DatumGetPointer(value))) {
+			value = DetoastPostgresDatum(reinterpret_cast<varlena *>(value), &should_free);
+		}
+		const char *text = VARDATA_ANY(value);
+		auto len = is_bpchar ? bpchartruelen(VARDATA_ANY(value), VARSIZE_ANY_EXHDR(value)) : VARSIZE_ANY_EXHDR(value);
+		bool added = dictionary.AddValue(text, len, offset + row);
+		if (should_free) {
+			duckdb_free(reinterpret_cast<void *>(value));
+		}
+		if (!added) {
+			return row;
+		}
 	}
 
-	/* Write tuple columns in output vector. */
-	for (idx_t idx = 0; idx < scan_global_state->m_output_columns_ids.size(); idx++) {
-		auto &result = output.data[idx];
-		idx_t output_column_idx = scan_global_state->m_read_columns_ids[scan_global_state->m_output_columns_ids[idx]];
-		if (nulls[output_column_idx]) {
-			auto &array_mask = duckdb::FlatVector::Validity(result);
-			array_mask.SetInvalid(scan_local_state->m_output_vector_size);
+	return column.nrows;
+}
+
+static void ConvertPostgresToDuckColumn(const FormData_pg_attribute &attr, const DecodedColumn &column,
+                                        duckdb::Vector &result, idx_t offset,
+                                        const duckdb::buffer_ptr<duckdb::VectorBuffer> &page_pins,
+                                        PostgresScanStringDictionary *dictionary);
+
+/*
+ * Text columns first go into the dictionary of the chunk, once that
+ * overflows the rows converted so far are flattened and the rest of the batch
+ * is converted as usual.
+ */
+static void
+ConvertPostgresToDuckStringColumn(const FormData_pg_attribute &attr, const DecodedColumn &column,
+                                  duckdb::Vector &result, idx_t offset,
+                                  const duckdb::buffer_ptr<duckdb::VectorBuffer> &page_pins,
+                                  PostgresScanStringDictionary &dictionary) {
+	int nadded = AppendStringColumnDictionary(attr, column, result, offset, dictionary);
+	if (nadded == column.nrows) {
+		return;
+	}
+
+	dictionary.Flatten(result, offset + nadded);
+	DecodedColumn rest = {column.values + nadded, column.tuple_data + nadded, column.fixed_offset,
+	                      column.nrows - nadded, column.has_nulls};
+	ConvertPostgresToDuckColumn(attr, rest, result, offset + nadded, page_pins, nullptr);
+}
+
+/*
+ * Convert one column of a decoded batch into the output vector. The type is
+ * looked at once per column, fixed-width types are then converted in a tight
+ * loop. Everything else goes through ConvertPostgresToDuckValue per value.
+ * page_pins is set when text values may point into the page of the batch,
+ * dictionary when text values are dictionary encoded.
+ */
+static void
+ConvertPostgresToDuckColumn(const FormData_pg_attribute &attr, const DecodedColumn &column, duckdb::Vector &result,
+                            idx_t offset, const duckdb::buffer_ptr<duckdb::VectorBuffer> &page_pins,
+                            PostgresScanStringDictionary *dictionary) {
+	auto &type = result.GetType();
+	switch (type.id()) {
+	case duckdb::LogicalTypeId::VARCHAR:
+		if (dictionary && dictionary->m_active) {
+			ConvertPostgresToDuckStringColumn(attr, column, result, offset, page_pins, *dictionary);
+			return;
+		}
+		if (page_pins && attr.attlen == -1) {
+			AppendStringColumnNoCopy(attr, column, result, offset, page_pins);
+			return;
+		}
+		break;
+	case duckdb::LogicalTypeId::BOOLEAN:
+		if (attr.attlen == 1) {
+			AppendFixedWidthColumn<bool, 1>(column, result, offset, [](Datum value) { return DatumGetBool(value); });
+			return;
+		}
+		break;
+	case duckdb::LogicalTypeId::TINYINT: {
+		auto aux_info = type.GetAuxInfoShrPtr();
+		if (attr.attlen == 1 && !(aux_info && dynamic_cast<IsBpChar *>(aux_info.get()))) {
+			AppendFixedWidthColumn<int8_t, 1>(column, result, offset,
+			                                  [](Datum value) { return (int8_t)DatumGetChar(value); });
+			return;
+		}
+		break;
+	}
+	case duckdb::LogicalTypeId::SMALLINT:
+		if (attr.attlen == 2) {
+			AppendFixedWidthColumn<int16_t, 2>(column, result, offset,
+			                                   [](Datum value) { return DatumGetInt16(value); });
+			return;
+		}
+		break;
+	case duckdb::LogicalTypeId::INTEGER:
+		if (attr.attlen == 4) {
+			AppendFixedWidthColumn<int32_t, 4>(column, result, offset,
+			                                   [](Datum value) { return DatumGetInt32(value); });
+			return;
+		}
+		break;
+	case duckdb::LogicalTypeId::UINTEGER:
+		if (attr.attlen == 4) {
+			AppendFixedWidthColumn<uint32_t, 4>(column, result, offset,
+			                                    [](Datum value) { return DatumGetUInt32(value); });
+			return;
+		}
+		break;
+	case duckdb::LogicalTypeId::BIGINT:
+		if (attr.attlen == 8) {
+			AppendFixedWidthColumn<int64_t, 8>(column, result, offset,
+			                                   [](Datum value) { return DatumGetInt64(value); });
+			return;
+		}
+		break;
+	case duckdb::LogicalTypeId::DATE:
+		if (attr.attlen == 4) {
+			AppendFixedWidthColumn<duckdb::date_t, 4>(column, result, offset, [](Datum value) {
+				return duckdb::date_t(DatumGetDateADT(value) + PGDUCKDB_DUCK_DATE_OFFSET);
+			});
+			return;
+		}
+		break;
+	case duckdb::LogicalTypeId::TIMESTAMP:
+	case duckdb::LogicalTypeId::TIMESTAMP_TZ:
+		if (attr.attlen == 8) {
+			AppendFixedWidthColumn<duckdb::timestamp_t, 8>(column, result, offset, [](Datum value) {
+				return duckdb::timestamp_t(DatumGetTimestamp(value) + PGDUCKDB_DUCK_TIMESTAMP_OFFSET);
+			});
+			return;
+		}
+		break;
+	case duckdb::LogicalTypeId::FLOAT:
+		if (attr.attlen == 4) {
+			AppendFixedWidthColumn<float, 4>(column, result, offset, [](Datum value) { return DatumGetFloat4(value); });
+			return;
+		}
+		break;
+	case duckdb::LogicalTypeId::DOUBLE: {
+		auto aux_info = type.GetAuxInfoShrPtr();
+		if (attr.attlen == 8 && !(aux_info && dynamic_cast<NumericAsDouble *>(aux_info.get()))) {
+			AppendFixedWidthColumn<double, 8>(column, result, offset,
+			                                  [](Datum value) { return DatumGetFloat8(value); });
+			return;
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	auto &validity = duckdb::FlatVector::Validity(result);
+	for (int row = 0; row < column.nrows; row++) {
+		if (column.has_nulls && !validity.RowIsValid(offset + row)) {
+			continue;
+		}
+		Datum value = DecodedColumnDatum(column, attr.attlen, row);
+		if (attr.attlen == -1) {
+			bool should_free = false;
+			value = DetoastPostgresDatum(reinterpret_cast<varlena *>(value), &should_free);
+			ConvertPostgresToDuckValue(attr.atttypid, value, result, offset + row);
+			if (should_free) {
+				duckdb_free(reinterpret_cast<void *>(value));
+			}
 		} else {
-			auto attr = scan_global_state->m_tuple_desc->attrs[scan_global_state->m_output_columns_ids[idx]];
-			if (attr.attlen == -1) {
-				bool should_free = false;
-				values[output_column_idx] =
-				    DetoastPostgresDatum(reinterpret_cast<varlena *>(values[output_column_idx]), &should_free);
-				ConvertPostgresToDuckValue(attr.atttypid, values[output_column_idx], result,
-				                           scan_local_state->m_output_vector_size);
-				if (should_free) {
-					duckdb_free(reinterpret_cast<void *>(values[output_column_idx]));
-				}
+			ConvertPostgresToDuckValue(attr.atttypid, value, result, offset + row);
+		}
+	}
+}
+
+/*
+ * Decode a batch of heap tuples, at most one page worth, into the output
+ * chunk. Tuples are first deformed row by row into column-major values/nulls
+ * arrays with the deform plan of the scan, the compiled filters then select
+ * the rows to keep over the whole batch. The surviving rows are written into
+ * the output column by column.
+ * Tuples without NULLs skip deforming of by-value columns at a fixed offset,
+ * those are copied straight out of the tuple data.
+ */
+void
+InsertTuplesIntoChunk(duckdb::DataChunk &output, duckdb::shared_ptr<PostgresScanGlobalState> scan_global_state,
+                      duckdb::shared_ptr<PostgresScanLocalState> scan_local_state, HeapTupleData *tuples, int ntuples) {
+	if (scan_global_state->m_count_tuples_only) {
+		scan_local_state->m_output_vector_size += ntuples;
+		return;
+	}
+
+	switch (scan_global_state->m_deform_shape) {
+	case PostgresScanDeformShape::ALL_FIXED:
+		DeformTuples<PostgresScanDeformShape::ALL_FIXED>(*scan_global_state, *scan_local_state, tuples, ntuples);
+		break;
+	default:
+		DeformTuples<PostgresScanDeformShape::FIXED_PREFIX_VARLENA>(*scan_global_state, *scan_local_state, tuples,
+		                                                            ntuples);
+		break;
+	}
+
+	if (scan_global_state->m_emit_rowid) {
+		for (int row = 0; row < ntuples; row++) {
+			scan_local_state->batch_rowids[row] = PostgresScanEncodeRowId(
+			    ItemPointerGetBlockNumber(&tuples[row].t_self), ItemPointerGetOffsetNumber(&tuples[row].t_self));
+		}
+	}
+
+	int nrows = ntuples;
+	if (!scan_global_state->m_column_filters.empty()) {
+		nrows = FilterDeformedTuples(*scan_global_state, *scan_local_state, ntuples);
+	}
+
+	if (nrows == 0) {
+		return;
+	}
+
+	/* Rows that went through the general walk, the only ones that can have NULLs */
+	uint64_t walked_rows[PGDUCKDB_SCAN_BATCH_SIZE / 64];
+	bool any_column_has_nulls = false;
+	for (idx_t i = 0; i < scan_global_state->m_read_columns_ids.size(); i++) {
+		any_column_has_nulls |= scan_local_state->column_has_nulls[i];
+	}
+	if (any_column_has_nulls) {
+		for (int word_idx = 0; word_idx * 64 < nrows; word_idx++) {
+			walked_rows[word_idx] = PackBoolsWord(scan_local_state->batch_row_walked + word_idx * 64);
+		}
+	}
+
+	duckdb::buffer_ptr<duckdb::VectorBuffer> page_pins;
+	if (scan_global_state->m_zero_copy_strings) {
+		page_pins = scan_local_state->PinBatchPage();
+	}
+
+	const auto &read_columns = scan_global_state->m_deform_read_columns;
+	auto &dictionaries = scan_local_state->m_dictionaries;
+	if (!scan_local_state->m_dictionaries_inited) {
+		for (idx_t idx = 0; idx < scan_global_state->m_output_read_columns.size(); idx++) {
+			if (scan_global_state->m_output_read_columns[idx] < 0) {
+				dictionaries.push_back(nullptr);
+				continue;
+			}
+			auto attnum = read_columns[scan_global_state->m_output_read_columns[idx]].attnum;
+			auto &type = output.data[idx].GetType();
+			if (type.id() == duckdb::LogicalTypeId::VARCHAR && scan_global_state->m_deform_attrs[attnum].attlen == -1 &&
+			    scan_global_state->UsesDictionary(attnum)) {
+				dictionaries.push_back(duckdb::make_uniq<PostgresScanStringDictionary>(type));
 			} else {
-				ConvertPostgresToDuckValue(attr.atttypid, values[output_column_idx], result,
-				                           scan_local_state->m_output_vector_size);
+				dictionaries.push_back(nullptr);
 			}
 		}
+		scan_local_state->m_dictionaries_inited = true;
 	}
 
-	scan_local_state->m_output_vector_size++;
-	scan_global_state->m_total_row_count++;
+	/* Write the batch into the output vectors one column at a time */
+	for (idx_t idx = 0; idx < scan_global_state->m_output_read_columns.size(); idx++) {
+		if (scan_global_state->m_output_read_columns[idx] < 0) {
+			auto rowids = duckdb::FlatVector::GetData<int64_t>(output.data[idx]);
+			memcpy(rowids + scan_local_state->m_output_vector_size, scan_local_state->batch_rowids,
+			       sizeof(int64_t) * nrows);
+			continue;
+		}
+		const auto &read_column = read_columns[scan_global_state->m_output_read_columns[idx]];
+		const auto &attr = scan_global_state->m_deform_attrs[read_column.attnum];
+		auto value_idx = read_column.value_idx;
+		auto &result = output.data[idx];
+		DecodedColumn column = {scan_local_state->values + value_idx * PGDUCKDB_SCAN_BATCH_SIZE,
+		                        scan_local_state->batch_tuple_data, attr.attbyval ? attr.fixed_offset : -1, nrows,
+		                        scan_local_state->column_has_nulls[value_idx]};
+		if (column.has_nulls) {
+			SetColumnValidity(scan_local_state->nulls + value_idx * PGDUCKDB_SCAN_BATCH_SIZE, walked_rows, nrows,
+			                  result, scan_local_state->m_output_vector_size);
+		}
+		ConvertPostgresToDuckColumn(scan_global_state->m_tuple_desc->attrs[read_column.attnum], column, result,
+		                            scan_local_state->m_output_vector_size, page_pins, dictionaries[idx].get());
+	}
+
+	scan_local_state->m_output_vector_size += nrows;
+	scan_global_state->m_total_row_count += nrows;
+}
+
+/*
+ * Complete an output chunk of count rows: text columns whose dictionary did
+ * not overflow become DICTIONARY vectors, and all dictionaries start over for
+ * the next chunk.
+ */
+void
+FinalizeOutputChunk(duckdb::DataChunk &output, duckdb::shared_ptr<PostgresScanLocalState> scan_local_state,
+                    idx_t count) {
+	auto &dictionaries = scan_local_state->m_dictionaries;
+	for (idx_t idx = 0; idx < dictionaries.size(); idx++) {
+		auto &dictionary = dictionaries[idx];
+		if (!dictionary) {
+			continue;
+		}
+		if (dictionary->m_active) {
+			output.data[idx].Slice(*dictionary->m_dictionary, dictionary->m_sel, count);
+		}
+		dictionary->Reset();
+	}
 }
 
 } // namespace pgduckdb
@@ -2,37 +2,224 @@
 
 extern "C" {
 #include "postgres.h"
+#include "miscadmin.h"
 #include "pgstat.h"
 #include "access/heapam.h"
+#include "access/syncscan.h"
+#include "access/tableam.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "catalog/pg_class.h"
 #include "storage/bufmgr.h"
 #include "storage/bufpage.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
 }
 
+#include "pgduckdb/pgduckdb.h"
 #include "pgduckdb/pgduckdb_process_lock.hpp"
 #include "pgduckdb/scan/heap_reader.hpp"
 #include "pgduckdb/pgduckdb_types.hpp"
 #include "pgduckdb/pgduckdb_utils.hpp"
 
+#include <algorithm>
 #include <optional>
 
 namespace pgduckdb {
 
+//
+// HeapReaderSample
+//
+
+/*
+ * Keep the block or tuple when a hash of the seed and its position, mapped
+ * to [0, 100), is below the percentage. Blocks of a SYSTEM sample are
+ * hashed with offset 0. The hash is the splitmix64 finalizer.
+ */
+bool
+HeapReaderSample::Keeps(BlockNumber block, OffsetNumber offset) const {
+	uint64_t hash = ((uint64_t)m_seed << 48) ^ ((uint64_t)block << 16) ^ offset;
+	hash ^= (uint64_t)m_seed >> 16;
+	hash = (hash ^ (hash >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	hash = (hash ^ (hash >> 27)) * UINT64_C(0x94d049bb133111eb);
+	hash ^= hash >> 31;
+	return (double)(hash >> 11) * (100.0 / (double)(UINT64_C(1) << 53)) < m_percentage;
+}
+
 //
 // HeapReaderGlobalState
 //
 
+/*
+ * Chunk sizing follows table_block_parallelscan_nextpage: the largest chunk is
+ * about 1/PARALLEL_SCAN_NCHUNKS of the relation, capped at
+ * PARALLEL_SCAN_MAX_CHUNK_SIZE blocks, and chunks shrink again once fewer than
+ * PARALLEL_SCAN_RAMPDOWN_CHUNKS chunks are left so that readers finish at
+ * about the same time.
+ */
+#define PARALLEL_SCAN_NCHUNKS         2048
+#define PARALLEL_SCAN_RAMPDOWN_CHUNKS 64
+#define PARALLEL_SCAN_MAX_CHUNK_SIZE  8192
+
+static uint32_t
+MaxChunkSize(uint64_t nblocks) {
+	uint32_t max_chunk_size = 1;
+	while (max_chunk_size < PARALLEL_SCAN_MAX_CHUNK_SIZE &&
+	       (uint64_t)max_chunk_size * PARALLEL_SCAN_NCHUNKS < nblocks) {
+		max_chunk_size <<= 1;
+	}
+	return max_chunk_size;
+}
+
+/* Relations without storage, like partitioned tables, are scanned as empty */
+HeapReaderGlobalState::HeapReaderGlobalState(Relation rel)
+    : m_nblocks(RELKIND_HAS_STORAGE(rel->rd_rel->relkind) ? RelationGetNumberOfBlocks(rel) : 0),
+      m_strategy(nullptr), m_max_chunk_size(MaxChunkSize(m_nblocks)), m_nallocated(0), m_nscan_blocks(m_nblocks),
+      m_sync_scan(false), m_start_block(0), m_end_block(m_nblocks), m_use_block_list(false), m_sync_start_block(0) {
+	/*
+	 * Same rule as heapam's initscan: only scans of relations larger than a
+	 * quarter of shared buffers go through a bulk read ring. The ring is
+	 * allocated in TopMemoryContext because the DuckDB executor may destroy
+	 * this state after the memory context that was current at this point.
+	 */
+	if (m_nblocks > (BlockNumber)(NBuffers / 4)) {
+		std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+		MemoryContext old_context = MemoryContextSwitchTo(TopMemoryContext);
+		m_strategy = PostgresFunctionGuard<BufferAccessStrategy>(GetAccessStrategy, BAS_BULKREAD);
+		MemoryContextSwitchTo(old_context);
+	}
+}
+
+HeapReaderGlobalState::~HeapReaderGlobalState() {
+	if (m_strategy) {
+		std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+		FreeAccessStrategy(m_strategy);
+	}
+}
+
+/*
+ * Hand out the next block to scan, blocks a SYSTEM sample drops are passed
+ * over without being read.
+ */
+BlockNumber
+HeapReaderGlobalState::AssignNextBlockNumber(HeapReaderBlockChunk &chunk) {
+	BlockNumber block = AssignNextCandidateBlock(chunk);
+	if (m_sample && m_sample->m_method == HeapReaderSample::SYSTEM) {
+		while (block != InvalidBlockNumber && !m_sample->Keeps(block, InvalidOffsetNumber)) {
+			block = AssignNextCandidateBlock(chunk);
+		}
+	}
+	return block;
+}
+
+/*
+ * Claim the next block of the scan range. Blocks are claimed from the shared
+ * counter in chunks, so the atomic is only touched once per chunk. A reader
+ * starts with single block chunks and doubles the chunk size on every claim
+ * until it reaches m_max_chunk_size; near the end of the relation the chunk
+ * size is halved again.
+ */
 BlockNumber
-HeapReaderGlobalState::AssignNextBlockNumber(std::mutex &lock) {
-	lock.lock();
-	BlockNumber block_number = InvalidBlockNumber;
-	if (m_nblocks > 0 && m_last_assigned_block_number == InvalidBlockNumber) {
-		block_number = m_last_assigned_block_number = 0;
-	} else if (m_nblocks > 0 && m_last_assigned_block_number < m_nblocks - 1) {
-		block_number = ++m_last_assigned_block_number;
+HeapReaderGlobalState::AssignNextCandidateBlock(HeapReaderBlockChunk &chunk) {
+	uint64_t nallocated;
+
+	if (chunk.m_chunk_remaining > 0) {
+		nallocated = ++chunk.m_nallocated;
+		chunk.m_chunk_remaining--;
+	} else {
+		uint32_t chunk_size = chunk.m_chunk_size == 0 ? 1 : chunk.m_chunk_size;
+		if (chunk.m_chunk_size != 0 && chunk_size < m_max_chunk_size) {
+			chunk_size <<= 1;
+		}
+
+		while (chunk_size > 1 &&
+		       chunk.m_nallocated + (uint64_t)chunk_size * PARALLEL_SCAN_RAMPDOWN_CHUNKS > m_nscan_blocks) {
+			chunk_size >>= 1;
+		}
+
+		nallocated = chunk.m_nallocated = m_nallocated.fetch_add(chunk_size, std::memory_order_relaxed);
+		chunk.m_chunk_size = chunk_size;
+		chunk.m_chunk_remaining = chunk_size - 1;
 	}
-	lock.unlock();
-	return block_number;
+
+	if (nallocated >= m_nscan_blocks) {
+		chunk.m_chunk_remaining = 0;
+		return InvalidBlockNumber;
+	}
+
+	if (m_sync_scan) {
+		return (BlockNumber)((m_sync_start_block + nallocated) % m_nblocks);
+	}
+	return m_use_block_list ? m_block_list[nallocated] : m_start_block + (BlockNumber)nallocated;
+}
+
+/*
+ * Only hand out the given blocks, which must be ascending. Chunks are then
+ * claimed from the block list, so readers still get runs of neighbouring
+ * blocks. Must be called before the first block is assigned.
+ */
+void
+HeapReaderGlobalState::RestrictToBlocks(duckdb::vector<BlockNumber> blocks) {
+	m_block_list = std::move(blocks);
+	/* Blocks added after the scan started are not scanned either way */
+	while (!m_block_list.empty() && m_block_list.back() >= m_end_block) {
+		m_block_list.pop_back();
+	}
+	m_block_list.erase(m_block_list.begin(),
+	                   std::lower_bound(m_block_list.begin(), m_block_list.end(), m_start_block));
+	m_use_block_list = true;
+	m_nscan_blocks = m_block_list.size();
+	m_max_chunk_size = MaxChunkSize(m_nscan_blocks);
+}
+
+/* Must be called before the first block is assigned */
+void
+HeapReaderGlobalState::SetSample(const HeapReaderSample &sample) {
+	m_sample = duckdb::make_uniq<HeapReaderSample>(sample);
+}
+
+/*
+ * Only hand out the blocks from start_block up to end_block, exclusive. The
+ * range is cut to the relation size. Must be called before the first block
+ * is assigned and before RestrictToBlocks.
+ */
+void
+HeapReaderGlobalState::RestrictToBlockRange(BlockNumber start_block, BlockNumber end_block) {
+	m_end_block = std::min(end_block, m_nblocks);
+	m_start_block = std::min(start_block, m_end_block);
+	m_nscan_blocks = m_end_block - m_start_block;
+	m_max_chunk_size = MaxChunkSize(m_nscan_blocks);
+}
+
+/*
+ * Join the synchronized scans of the relation, like heapam's initscan does:
+ * only scans of the whole relation that go through a bulk read ring take
+ * part, and only with synchronize_seqscans on. Blocks are then handed out
+ * from where the other scans of the relation currently are, wrapping around
+ * at the end, so that concurrent scans find each other's blocks in shared
+ * buffers. Must be called after the scan was restricted, before the first
+ * block is assigned.
+ */
+void
+HeapReaderGlobalState::SynchronizeScan(Relation rel) {
+	if (!m_strategy || !synchronize_seqscans || m_use_block_list || m_nscan_blocks != m_nblocks) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+	m_sync_start_block = PostgresFunctionGuard<BlockNumber>(ss_get_location, rel, m_nblocks);
+	m_sync_scan = true;
+}
+
+/*
+ * The blocks [start_block, end_block) the readers scan. Returns false when
+ * the scan is restricted to a block list.
+ */
+bool
+HeapReaderGlobalState::GetBlockRange(BlockNumber &start_block, BlockNumber &end_block) const {
+	start_block = m_start_block;
+	end_block = m_end_block;
+	return !m_use_block_list;
 }
 
 //
@@ -43,41 +230,419 @@ HeapReader::HeapReader(Relation rel, duckdb::shared_ptr<HeapReaderGlobalState> h
                        duckdb::shared_ptr<PostgresScanGlobalState> global_state,
                        duckdb::shared_ptr<PostgresScanLocalState> local_state)
     : m_global_state(global_state), m_heap_reader_global_state(heap_reader_global_state), m_local_state(local_state),
-      m_rel(rel), m_inited(false), m_read_next_page(true), m_block_number(InvalidBlockNumber), m_buffer(InvalidBuffer),
-      m_current_tuple_index(InvalidOffsetNumber), m_page_tuples_left(0) {
-	m_tuple.t_data = NULL;
-	m_tuple.t_tableOid = RelationGetRelid(m_rel);
-	ItemPointerSetInvalid(&m_tuple.t_self);
+      m_rel(rel), m_inited(false), m_read_next_page(true), m_block_number(InvalidBlockNumber),
+      m_prefetch_distance(duckdb_postgres_scan_prefetch_distance), m_prefetch_exhausted(false), m_buffer(InvalidBuffer),
+      m_buffer_locked(false), m_page_ntuples(0), m_page_tuple_index(0) {
+	for (auto &tuple : m_batch_tuples) {
+		tuple.t_data = NULL;
+		tuple.t_tableOid = RelationGetRelid(m_rel);
+		ItemPointerSetInvalid(&tuple.t_self);
+	}
 }
 
 HeapReader::~HeapReader() {
 	/* If execution is interrupted and buffer is still opened close it now */
 	if (m_buffer != InvalidBuffer) {
 		DuckdbProcessLock::GetLock().lock();
-		UnlockReleaseBuffer(m_buffer);
+		ReleaseCurrentBuffer();
 		DuckdbProcessLock::GetLock().unlock();
 	}
 }
 
+//
+// XidStatusCache
+//
+
+XidStatusCache::XidStatusCache() {
+	for (int i = 0; i < XID_STATUS_CACHE_SIZE; i++) {
+		m_xids[i] = InvalidTransactionId;
+		m_status[i] = XID_STATUS_UNKNOWN;
+	}
+}
+
+XidStatusCache::Status
+XidStatusCache::Lookup(TransactionId xid) const {
+	int slot = xid % XID_STATUS_CACHE_SIZE;
+	return m_xids[slot] == xid ? (Status)m_status[slot] : XID_STATUS_UNKNOWN;
+}
+
+void
+XidStatusCache::Store(TransactionId xid, Status status) {
+	int slot = xid % XID_STATUS_CACHE_SIZE;
+	m_xids[slot] = xid;
+	m_status[slot] = status;
+}
+
+/*
+ * Determine whether the effects of the transaction are visible to the
+ * snapshot, the same way HeapTupleSatisfiesMVCC does. Our own transaction
+ * depends on command ids, so it is never resolved here. DuckdbProcessLock must
+ * be held.
+ */
+static XidStatusCache::Status
+ResolveXidStatus(TransactionId xid, Snapshot snapshot) {
+	if (!TransactionIdIsNormal(xid) || TransactionIdIsCurrentTransactionId(xid)) {
+		return XidStatusCache::XID_STATUS_UNKNOWN;
+	}
+	if (XidInMVCCSnapshot(xid, snapshot)) {
+		return XidStatusCache::XID_STATUS_NOT_COMMITTED;
+	}
+	return TransactionIdDidCommit(xid) ? XidStatusCache::XID_STATUS_COMMITTED
+	                                   : XidStatusCache::XID_STATUS_NOT_COMMITTED;
+}
+
+enum class TupleVisibility { VISIBLE, INVISIBLE, UNKNOWN };
+
+/*
+ * Decide the visibility of a tuple for an MVCC snapshot from its hint bits
+ * and the xid status cache only, without touching clog or any shared state.
+ * The buffer must be share locked. Anything that needs more than that
+ * (multixacts, our own transaction, xids without hint bits that are not
+ * cached yet) is UNKNOWN and must go through HeapTupleSatisfiesVisibility.
+ */
+static TupleVisibility
+HeapTupleVisibilityFastPath(HeapTupleHeader tuple, Snapshot snapshot, const XidStatusCache &cache) {
+	uint16 infomask = tuple->t_infomask;
+
+	if (infomask & HEAP_MOVED) {
+		return TupleVisibility::UNKNOWN;
+	}
+
+	/* Is the inserting transaction visible to the snapshot? */
+	if (!HeapTupleHeaderXminCommitted(tuple)) {
+		if (HeapTupleHeaderXminInvalid(tuple)) {
+			return TupleVisibility::INVISIBLE;
+		}
+		switch (cache.Lookup(HeapTupleHeaderGetRawXmin(tuple))) {
+		case XidStatusCache::XID_STATUS_COMMITTED:
+			break;
+		case XidStatusCache::XID_STATUS_NOT_COMMITTED:
+			return TupleVisibility::INVISIBLE;
+		default:
+			return TupleVisibility::UNKNOWN;
+		}
+	} else if (!HeapTupleHeaderXminFrozen(tuple) &&
+	           !TransactionIdPrecedes(HeapTupleHeaderGetRawXmin(tuple), snapshot->xmin)) {
+		/* Committed, but maybe still running as far as the snapshot is concerned */
+		switch (cache.Lookup(HeapTupleHeaderGetRawXmin(tuple))) {
+		case XidStatusCache::XID_STATUS_COMMITTED:
+			break;
+		case XidStatusCache::XID_STATUS_NOT_COMMITTED:
+			return TupleVisibility::INVISIBLE;
+		default:
+			return TupleVisibility::UNKNOWN;
+		}
+	}
+
+	/* Was the tuple deleted by a transaction visible to the snapshot? */
+	if ((infomask & HEAP_XMAX_INVALID) || HEAP_XMAX_IS_LOCKED_ONLY(infomask)) {
+		return TupleVisibility::VISIBLE;
+	}
+
+	if (infomask & HEAP_XMAX_IS_MULTI) {
+		return TupleVisibility::UNKNOWN;
+	}
+
+	TransactionId xmax = HeapTupleHeaderGetRawXmax(tuple);
+	if ((infomask & HEAP_XMAX_COMMITTED) && TransactionIdPrecedes(xmax, snapshot->xmin)) {
+		return TupleVisibility::INVISIBLE;
+	}
+
+	switch (cache.Lookup(xmax)) {
+	case XidStatusCache::XID_STATUS_COMMITTED:
+		return TupleVisibility::INVISIBLE;
+	case XidStatusCache::XID_STATUS_NOT_COMMITTED:
+		return TupleVisibility::VISIBLE;
+	default:
+		return TupleVisibility::UNKNOWN;
+	}
+}
+
+/*
+ * Run the full visibility check for the tuples the fast path could not
+ * decide and remove the invisible ones from page_tuples. The xids of these
+ * tuples are resolved into the cache, so later tuples of the same
+ * transactions take the fast path. The buffer must be share locked and
+ * DuckdbProcessLock held.
+ */
+static int
+ResolvePageTupleVisibility(Relation rel, Buffer buffer, Snapshot snapshot, OffsetNumber *page_tuples, int ntuples,
+                           const uint16 *unknown_tuples, int nunknown, XidStatusCache *cache) {
+	Page page = BufferGetPage(buffer);
+	HeapTupleData tuple;
+
+	tuple.t_tableOid = RelationGetRelid(rel);
+
+	for (int i = 0; i < nunknown; i++) {
+		OffsetNumber offset = page_tuples[unknown_tuples[i]];
+		ItemId lpp = PageGetItemId(page, offset);
+
+		tuple.t_data = (HeapTupleHeader)PageGetItem(page, lpp);
+		tuple.t_len = ItemIdGetLength(lpp);
+		ItemPointerSet(&(tuple.t_self), BufferGetBlockNumber(buffer), offset);
+
+		/* skip tuples not visible to this snapshot */
+		if (!HeapTupleSatisfiesVisibility(&tuple, snapshot, buffer)) {
+			page_tuples[unknown_tuples[i]] = InvalidOffsetNumber;
+		}
+
+		if (snapshot->snapshot_type != SNAPSHOT_MVCC) {
+			continue;
+		}
+
+		/* Hinted xmins older than the snapshot xmin never need the cache */
+		TransactionId xmin = HeapTupleHeaderGetRawXmin(tuple.t_data);
+		bool xmin_decided = HeapTupleHeaderXminInvalid(tuple.t_data) ||
+		                    (HeapTupleHeaderXminCommitted(tuple.t_data) &&
+		                     (HeapTupleHeaderXminFrozen(tuple.t_data) || TransactionIdPrecedes(xmin, snapshot->xmin)));
+		if (!xmin_decided && cache->Lookup(xmin) == XidStatusCache::XID_STATUS_UNKNOWN) {
+			cache->Store(xmin, ResolveXidStatus(xmin, snapshot));
+		}
+
+		uint16 infomask = tuple.t_data->t_infomask;
+		if (!(infomask & (HEAP_XMAX_INVALID | HEAP_XMAX_IS_MULTI)) && !HEAP_XMAX_IS_LOCKED_ONLY(infomask)) {
+			TransactionId xmax = HeapTupleHeaderGetRawXmax(tuple.t_data);
+			if (cache->Lookup(xmax) == XidStatusCache::XID_STATUS_UNKNOWN) {
+				cache->Store(xmax, ResolveXidStatus(xmax, snapshot));
+			}
+		}
+	}
+
+	int nvisible = 0;
+	for (int i = 0; i < ntuples; i++) {
+		if (page_tuples[i] != InvalidOffsetNumber) {
+			page_tuples[nvisible++] = page_tuples[i];
+		}
+	}
+	return nvisible;
+}
+
+/*
+ * Read and share lock the block, returns whether all tuples on it are visible
+ * to the snapshot. Must be called with DuckdbProcessLock held.
+ */
+static bool
+ReadAndLockBlock(Relation rel, BlockNumber block, BufferAccessStrategy strategy, Snapshot snapshot, Buffer *buffer) {
+	*buffer = ReadBufferExtended(rel, MAIN_FORKNUM, block, RBM_NORMAL, strategy);
+	LockBuffer(*buffer, BUFFER_LOCK_SHARE);
+
+	Page page = BufferGetPage(*buffer);
+#if PG_VERSION_NUM < 170000
+	TestForOldSnapshot(snapshot, rel, page);
+#endif
+	return PageIsAllVisible(page) && !snapshot->takenDuringRecovery;
+}
+
+/*
+ * All tuples of an all-visible page are visible to every snapshot, so every
+ * normal line pointer is returned. The buffer must be share locked.
+ */
+static int
+CollectAllVisiblePageTuples(Page page, OffsetNumber *page_tuples) {
+	OffsetNumber max_offset = PageGetMaxOffsetNumber(page);
+	int ntuples = 0;
+
+	for (OffsetNumber offset = FirstOffsetNumber; offset <= max_offset; offset++) {
+		if (ItemIdIsNormal(PageGetItemId(page, offset))) {
+			page_tuples[ntuples++] = offset;
+		}
+	}
+	return ntuples;
+}
+
+/*
+ * Read the block and determine its visible tuples page-at-a-time, like
+ * heapam's heapgetpage. The page is read and share locked under
+ * DuckdbProcessLock.
+ *
+ * For all-visible pages the line pointers are collected right away and the
+ * content lock is released again before DuckdbProcessLock, the tuples are
+ * decoded holding only the buffer pin (pruning and defragmentation need a
+ * cleanup lock). A COUNT(*) scan only needs the number of tuples, so it drops
+ * the pin of an all-visible page immediately as well and returns no page.
+ *
+ * For other pages visibility is decided without DuckdbProcessLock by
+ * HeapTupleVisibilityFastPath. DuckdbProcessLock is taken again after that
+ * pass to run the full HeapTupleSatisfiesVisibility check on the tuples that
+ * need it and to release the content lock, so the tuples are again decoded
+ * holding only the pin.
+ *
+ * With zone maps, every block is still read and share locked first, its page
+ * LSN decides whether the zone map may be used. Blocks they exclude are
+ * released right away and no page is returned, which saves the visibility
+ * checks and the decoding of their tuples but not the read. Every other block
+ * is recorded with the LSN read under the content lock.
+ */
 Page
 HeapReader::PreparePageRead() {
+	Snapshot snapshot = m_global_state->m_snapshot;
+	auto zone_map = m_heap_reader_global_state->m_zone_map.get();
+	bool all_visible;
+	XLogRecPtr page_lsn = InvalidXLogRecPtr;
+	OffsetNumber page_max_offset = InvalidOffsetNumber;
+
+	m_page_ntuples = 0;
+	m_page_tuple_index = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+		PrefetchBlocks();
+		if (m_heap_reader_global_state->m_sync_scan) {
+			PostgresFunctionGuard(ss_report_location, m_rel, m_block_number);
+		}
+		all_visible = PostgresFunctionGuard<bool>(ReadAndLockBlock, m_rel, m_block_number,
+		                                          m_heap_reader_global_state->m_strategy, snapshot, &m_buffer);
+		m_buffer_locked = true;
+
+		if (zone_map) {
+			page_lsn = PageGetLSN(BufferGetPage(m_buffer));
+			page_max_offset = PageGetMaxOffsetNumber(BufferGetPage(m_buffer));
+			if (zone_map->CanSkipBlock(m_block_number, page_lsn)) {
+				ReleaseCurrentBuffer();
+				return nullptr;
+			}
+		}
+
+		if (all_visible) {
+			m_page_ntuples = CollectAllVisiblePageTuples(BufferGetPage(m_buffer), m_page_tuples);
+			if (m_global_state->m_count_tuples_only) {
+				ReleaseCurrentBuffer();
+				return nullptr;
+			}
+			PostgresFunctionGuard(LockBuffer, m_buffer, BUFFER_LOCK_UNLOCK);
+			m_buffer_locked = false;
+		}
+	}
+
 	Page page = BufferGetPage(m_buffer);
-#if PG_VERSION_NUM < 170000
-	TestForOldSnapshot(m_global_state->m_snapshot, m_rel, page);
-#endif
-	m_page_tuples_all_visible = PageIsAllVisible(page) && !m_global_state->m_snapshot->takenDuringRecovery;
-	m_page_tuples_left = PageGetMaxOffsetNumber(page) - FirstOffsetNumber + 1;
-	m_current_tuple_index = FirstOffsetNumber;
+	if (zone_map) {
+		zone_map->RecordBlock(m_block_number, page_lsn, page, page_max_offset);
+	}
+	if (all_visible) {
+		return page;
+	}
+
+	OffsetNumber max_offset = PageGetMaxOffsetNumber(page);
+	bool use_fast_path = snapshot->snapshot_type == SNAPSHOT_MVCC;
+	uint16 unknown_tuples[MaxHeapTuplesPerPage];
+	int nunknown = 0;
+
+	for (OffsetNumber offset = FirstOffsetNumber; offset <= max_offset; offset++) {
+		ItemId lpp = PageGetItemId(page, offset);
+
+		if (!ItemIdIsNormal(lpp)) {
+			continue;
+		}
+
+		auto visibility = TupleVisibility::UNKNOWN;
+		if (use_fast_path) {
+			visibility =
+			    HeapTupleVisibilityFastPath((HeapTupleHeader)PageGetItem(page, lpp), snapshot, m_xid_status_cache);
+		}
+		if (visibility == TupleVisibility::INVISIBLE) {
+			continue;
+		} else if (visibility == TupleVisibility::UNKNOWN) {
+			unknown_tuples[nunknown++] = m_page_ntuples;
+		}
+
+		m_page_tuples[m_page_ntuples++] = offset;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+		if (nunknown > 0) {
+			m_page_ntuples = PostgresFunctionGuard<int>(ResolvePageTupleVisibility, m_rel, m_buffer, snapshot,
+			                                            m_page_tuples, m_page_ntuples, (const uint16 *)unknown_tuples,
+			                                            nunknown, &m_xid_status_cache);
+		}
+		PostgresFunctionGuard(LockBuffer, m_buffer, BUFFER_LOCK_UNLOCK);
+		m_buffer_locked = false;
+	}
+
 	return page;
 }
 
+/* Drop the visible tuples of the page that a BERNOULLI sample does not keep */
+void
+HeapReader::SamplePageTuples(BlockNumber block) {
+	const auto &sample = *m_heap_reader_global_state->m_sample;
+	int nkept = 0;
+	for (int i = 0; i < m_page_ntuples; i++) {
+		if (sample.Keeps(block, m_page_tuples[i])) {
+			m_page_tuples[nkept++] = m_page_tuples[i];
+		}
+	}
+	m_page_ntuples = nkept;
+}
+
+/*
+ * Drop the pin, and the content lock if it is still held, of the current
+ * buffer. DuckdbProcessLock must be held.
+ */
+void
+HeapReader::ReleaseCurrentBuffer() {
+	if (m_buffer_locked) {
+		UnlockReleaseBuffer(m_buffer);
+	} else {
+		ReleaseBuffer(m_buffer);
+	}
+	m_buffer = InvalidBuffer;
+	m_buffer_locked = false;
+}
+
+/*
+ * Blocks for which a prefetch was already issued are read first, only when
+ * none are queued we claim a new block directly.
+ */
+BlockNumber
+HeapReader::NextBlockNumber() {
+	if (!m_prefetch_blocks.empty()) {
+		BlockNumber block = m_prefetch_blocks.front();
+		m_prefetch_blocks.pop_front();
+		return block;
+	}
+	return m_heap_reader_global_state->AssignNextBlockNumber(m_block_chunk);
+}
+
+/*
+ * Keep up to m_prefetch_distance upcoming blocks assigned to this reader and
+ * ask the kernel to start reading them (posix_fadvise through PrefetchBuffer),
+ * so that the synchronous ReadBufferExtended calls mostly find the data
+ * already in the page cache. DuckdbProcessLock must be held.
+ */
+void
+HeapReader::PrefetchBlocks() {
+	while (!m_prefetch_exhausted && m_prefetch_blocks.size() < (size_t)m_prefetch_distance) {
+		BlockNumber block = m_heap_reader_global_state->AssignNextBlockNumber(m_block_chunk);
+		if (block == InvalidBlockNumber) {
+			m_prefetch_exhausted = true;
+			break;
+		}
+		PostgresFunctionGuard<PrefetchBufferResult>(PrefetchBuffer, m_rel, MAIN_FORKNUM, block);
+		m_prefetch_blocks.push_back(block);
+	}
+}
+
+/* Add the tuples to the tuples_returned statistics, like pgstat_count_heap_getnext does for every tuple */
+static inline void
+CountTuplesReturned(Relation rel, int ntuples) {
+	if (!pgstat_should_count_relation(rel)) {
+		return;
+	}
+#if PG_VERSION_NUM >= 160000
+	rel->pgstat_info->counts.tuples_returned += ntuples;
+#else
+	rel->pgstat_info->t_counts.t_tuples_returned += ntuples;
+#endif
+}
+
 bool
 HeapReader::ReadPageTuples(duckdb::DataChunk &output) {
 	BlockNumber block = InvalidBlockNumber;
 	Page page = nullptr;
 
 	if (!m_inited) {
-		block = m_block_number = m_heap_reader_global_state->AssignNextBlockNumber(m_global_state->m_lock);
+		block = m_block_number = NextBlockNumber();
 		if (m_block_number == InvalidBlockNumber) {
 			return false;
 		}
@@ -85,7 +650,7 @@ HeapReader::ReadPageTuples(duckdb::DataChunk &output) {
 		m_read_next_page = true;
 	} else {
 		block = m_block_number;
-		if(!m_read_next_page) {
+		if (!m_read_next_page && m_buffer != InvalidBuffer) {
 			page = BufferGetPage(m_buffer);
 		}
 	}
@@ -93,59 +658,68 @@ HeapReader::ReadPageTuples(duckdb::DataChunk &output) {
 	while (block != InvalidBlockNumber) {
 		if (m_read_next_page) {
 			CHECK_FOR_INTERRUPTS();
-			std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
-			block = m_block_number;
-
-			m_buffer = PostgresFunctionGuard<Buffer>(ReadBufferExtended, m_rel, MAIN_FORKNUM, block, RBM_NORMAL,
-			                                         GetAccessStrategy(BAS_BULKREAD));
-
-			PostgresFunctionGuard(LockBuffer, m_buffer, BUFFER_LOCK_SHARE);
-
 			page = PreparePageRead();
 			m_read_next_page = false;
+			if (m_heap_reader_global_state->m_sample &&
+			    m_heap_reader_global_state->m_sample->m_method == HeapReaderSample::BERNOULLI) {
+				SamplePageTuples(block);
+			}
 		}
 
-		for (; m_page_tuples_left > 0 && m_local_state->m_output_vector_size < STANDARD_VECTOR_SIZE;
-		     m_page_tuples_left--, m_current_tuple_index++) {
-			bool visible = true;
-			ItemId lpp = PageGetItemId(page, m_current_tuple_index);
-
-			if (!ItemIdIsNormal(lpp))
-				continue;
+		if (m_global_state->m_count_tuples_only) {
+			/* COUNT(*) only needs the number of visible tuples, no tuple is looked at */
+			int ntuples = std::min(m_page_ntuples - m_page_tuple_index,
+			                       (int)STANDARD_VECTOR_SIZE - m_local_state->m_output_vector_size);
+			if (m_global_state->m_emit_rowid) {
+				auto rowids = duckdb::FlatVector::GetData<int64_t>(output.data[0]);
+				for (int i = 0; i < ntuples; i++) {
+					rowids[m_local_state->m_output_vector_size + i] =
+					    PostgresScanEncodeRowId(block, m_page_tuples[m_page_tuple_index + i]);
+				}
+			}
+			m_local_state->m_output_vector_size += ntuples;
+			m_page_tuple_index += ntuples;
+			CountTuplesReturned(m_rel, ntuples);
+		}
 
-			m_tuple.t_data = (HeapTupleHeader)PageGetItem(page, lpp);
-			m_tuple.t_len = ItemIdGetLength(lpp);
-			ItemPointerSet(&(m_tuple.t_self), block, m_current_tuple_index);
+		/* Decode as many of the remaining page tuples as fit in the output in one batch */
+		int nbatch = std::min(m_page_ntuples - m_page_tuple_index,
+		                      (int)STANDARD_VECTOR_SIZE - m_local_state->m_output_vector_size);
+		if (nbatch > 0) {
+			for (int i = 0; i < nbatch; i++) {
+				OffsetNumber offset = m_page_tuples[m_page_tuple_index + i];
+				ItemId lpp = PageGetItemId(page, offset);
+				HeapTupleData &tuple = m_batch_tuples[i];
 
-			if (!m_page_tuples_all_visible) {
-				std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
-				visible = HeapTupleSatisfiesVisibility(&m_tuple, m_global_state->m_snapshot, m_buffer);
-				/* skip tuples not visible to this snapshot */
-				if (!visible)
-					continue;
+				tuple.t_data = (HeapTupleHeader)PageGetItem(page, lpp);
+				tuple.t_len = ItemIdGetLength(lpp);
+				ItemPointerSet(&(tuple.t_self), block, offset);
 			}
-
-			pgstat_count_heap_getnext(m_rel);
-			InsertTupleIntoChunk(output, m_global_state, m_local_state, &m_tuple);
+			m_page_tuple_index += nbatch;
+			CountTuplesReturned(m_rel, nbatch);
+			m_local_state->m_batch_buffer = m_buffer;
+			InsertTuplesIntoChunk(output, m_global_state, m_local_state, m_batch_tuples, nbatch);
 		}
 
 		/* No more items on current page */
-		if (!m_page_tuples_left) {
-			DuckdbProcessLock::GetLock().lock();
-			UnlockReleaseBuffer(m_buffer);
-			DuckdbProcessLock::GetLock().unlock();
-			m_buffer = InvalidBuffer;
+		if (m_page_tuple_index == m_page_ntuples) {
+			if (m_buffer != InvalidBuffer) {
+				DuckdbProcessLock::GetLock().lock();
+				ReleaseCurrentBuffer();
+				DuckdbProcessLock::GetLock().unlock();
+			}
 			m_read_next_page = true;
 			/* Handle cancel request */
 			if (QueryCancelPending) {
 				block = m_block_number = InvalidBlockNumber;
 			} else {
-				block = m_block_number = m_heap_reader_global_state->AssignNextBlockNumber(m_global_state->m_lock);
+				block = m_block_number = NextBlockNumber();
 			}
 		}
 
 		/* We have collected STANDARD_VECTOR_SIZE */
 		if (m_local_state->m_output_vector_size == STANDARD_VECTOR_SIZE) {
+			FinalizeOutputChunk(output, m_local_state, m_local_state->m_output_vector_size);
 			output.SetCardinality(m_local_state->m_output_vector_size);
 			output.Verify();
 			m_local_state->m_output_vector_size = 0;
@@ -155,6 +729,7 @@ HeapReader::ReadPageTuples(duckdb::DataChunk &output) {
 
 	/* Next assigned block number is InvalidBlockNumber so we check did we write any tuples in output vector */
 	if (m_local_state->m_output_vector_size) {
+		FinalizeOutputChunk(output, m_local_state, m_local_state->m_output_vector_size);
 		output.SetCardinality(m_local_state->m_output_vector_size);
 		output.Verify();
 		m_local_state->m_output_vector_size = 0;
@@ -162,7 +737,6 @@ HeapReader::ReadPageTuples(duckdb::DataChunk &output) {
 
 	m_buffer = InvalidBuffer;
 	m_block_number = InvalidBlockNumber;
-	m_tuple.t_data = NULL;
 	m_read_next_page = false;
 
 	return false;
@@ -0,0 +1,495 @@
+#include "duckdb.hpp"
+#include "duckdb/planner/filter/constant_filter.hpp"
+#include "duckdb/planner/filter/conjunction_filter.hpp"
+#include "duckdb/planner/filter/optional_filter.hpp"
+
+extern "C" {
+#include "postgres.h"
+#include "miscadmin.h"
+#include "access/genam.h"
+#include "access/htup_details.h"
+#include "access/relscan.h"
+#include "access/stratnum.h"
+#include "catalog/index.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_index.h"
+#include "catalog/pg_statistic.h"
+#include "catalog/pg_type.h"
+#include "commands/defrem.h"
+#include "nodes/makefuncs.h"
+#include "nodes/tidbitmap.h"
+#include "optimizer/predtest.h"
+#include "parser/parse_coerce.h"
+#include "utils/builtins.h"
+#include "utils/date.h"
+#include "utils/lsyscache.h"
+#include "utils/partcache.h"
+#include "utils/relcache.h"
+#include "utils/selfuncs.h"
+#include "utils/syscache.h"
+#include "utils/timestamp.h"
+}
+
+#include "pgduckdb/pgduckdb.h"
+#include "pgduckdb/pgduckdb_process_lock.hpp"
+#include "pgduckdb/pgduckdb_types.hpp"
+#include "pgduckdb/pgduckdb_utils.hpp"
+#include "pgduckdb/scan/postgres_index_pruning.hpp"
+#include "pgduckdb/vendor/pg_list.hpp"
+
+#include <algorithm>
+
+namespace pgduckdb {
+
+/* Largest estimated fraction of the rows for which a btree index bitmap is built */
+#define PGDUCKDB_BITMAP_SCAN_MAX_SELECTIVITY 0.1
+
+/* Btree strategy of a DuckDB comparison, InvalidStrategy for the ones that have none */
+static StrategyNumber
+ComparisonStrategy(duckdb::ExpressionType comparison) {
+	switch (comparison) {
+	case duckdb::ExpressionType::COMPARE_EQUAL:
+		return BTEqualStrategyNumber;
+	case duckdb::ExpressionType::COMPARE_LESSTHAN:
+		return BTLessStrategyNumber;
+	case duckdb::ExpressionType::COMPARE_LESSTHANOREQUALTO:
+		return BTLessEqualStrategyNumber;
+	case duckdb::ExpressionType::COMPARE_GREATERTHAN:
+		return BTGreaterStrategyNumber;
+	case duckdb::ExpressionType::COMPARE_GREATERTHANOREQUALTO:
+		return BTGreaterEqualStrategyNumber;
+	default:
+		return InvalidStrategy;
+	}
+}
+
+bool
+PostgresScanFilterConstantDatum(const duckdb::Value &constant, Oid type_oid, Datum &datum) {
+	switch (type_oid) {
+	case BOOLOID:
+		datum = BoolGetDatum(constant.GetValueUnsafe<bool>());
+		return true;
+	case INT2OID:
+		datum = Int16GetDatum(constant.GetValueUnsafe<int16_t>());
+		return true;
+	case INT4OID:
+		datum = Int32GetDatum(constant.GetValueUnsafe<int32_t>());
+		return true;
+	case INT8OID:
+		datum = Int64GetDatum(constant.GetValueUnsafe<int64_t>());
+		return true;
+	case FLOAT4OID:
+		datum = Float4GetDatum(constant.GetValueUnsafe<float>());
+		return true;
+	case FLOAT8OID:
+		datum = Float8GetDatum(constant.GetValueUnsafe<double>());
+		return true;
+	case DATEOID:
+		datum = DateADTGetDatum(constant.GetValueUnsafe<int32_t>() - PGDUCKDB_DUCK_DATE_OFFSET);
+		return true;
+	case TIMESTAMPOID:
+		datum = TimestampGetDatum(constant.GetValueUnsafe<int64_t>() - PGDUCKDB_DUCK_TIMESTAMP_OFFSET);
+		return true;
+	case TIMESTAMPTZOID:
+		datum = TimestampTzGetDatum(constant.GetValueUnsafe<int64_t>() - PGDUCKDB_DUCK_TIMESTAMP_OFFSET);
+		return true;
+	case TEXTOID: {
+		auto &str = duckdb::StringValue::Get(constant);
+		datum = PointerGetDatum(cstring_to_text_with_len(str.c_str(), str.size()));
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+void
+PostgresScanFilterComparisons(duckdb::TableFilter &filter,
+                              duckdb::vector<std::pair<StrategyNumber, duckdb::Value>> &comparisons) {
+	switch (filter.filter_type) {
+	case duckdb::TableFilterType::CONJUNCTION_AND: {
+		auto &conjunction = filter.Cast<duckdb::ConjunctionAndFilter>();
+		for (auto &child_filter : conjunction.child_filters) {
+			PostgresScanFilterComparisons(*child_filter, comparisons);
+		}
+		break;
+	}
+	case duckdb::TableFilterType::OPTIONAL_FILTER:
+		PostgresScanFilterComparisons(*filter.Cast<duckdb::OptionalFilter>().child_filter, comparisons);
+		break;
+	case duckdb::TableFilterType::CONSTANT_COMPARISON: {
+		auto &constant_filter = filter.Cast<duckdb::ConstantFilter>();
+		auto strategy = ComparisonStrategy(constant_filter.comparison_type);
+		if (strategy != InvalidStrategy && !constant_filter.constant.IsNull()) {
+			comparisons.emplace_back(strategy, constant_filter.constant);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+/* Whether the value of the leading index column satisfies all scan keys on it */
+static bool
+LeadingKeysMatch(const duckdb::vector<ScanKeyData> &keys, Datum value) {
+	for (const auto &key : keys) {
+		if (key.sk_attno != 1) {
+			break;
+		}
+		if (!DatumGetBool(FunctionCall2Coll((FmgrInfo *)&key.sk_func, key.sk_collation, value, key.sk_argument))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+double
+PostgresScanEstimateIndexSelectivity(Relation rel, Relation index, const duckdb::vector<ScanKeyData> &keys) {
+	double reltuples = std::max((double)rel->rd_rel->reltuples, 1.0);
+	int nkeyatts = IndexRelationGetNumberOfKeyAttributes(index);
+	int nequal_columns = 0;
+	bool leading_equality = false;
+	for (const auto &key : keys) {
+		if (key.sk_strategy == BTEqualStrategyNumber && key.sk_attno == nequal_columns + 1) {
+			nequal_columns++;
+			leading_equality |= key.sk_attno == 1;
+		}
+	}
+	if (index->rd_index->indisunique && nequal_columns == nkeyatts) {
+		return 1.0 / reltuples;
+	}
+
+	HeapTuple stats_tuple =
+	    SearchSysCache3(STATRELATTINH, ObjectIdGetDatum(RelationGetRelid(rel)),
+	                    Int16GetDatum(index->rd_index->indkey.values[0]), BoolGetDatum(false));
+	if (!HeapTupleIsValid(stats_tuple)) {
+		return leading_equality ? DEFAULT_EQ_SEL : DEFAULT_INEQ_SEL;
+	}
+
+	auto stats = (Form_pg_statistic)GETSTRUCT(stats_tuple);
+	double selectivity = 0;
+	double mcv_frequency = 0;
+	int nmcv = 0;
+	AttStatsSlot sslot;
+	if (get_attstatsslot(&sslot, stats_tuple, STATISTIC_KIND_MCV, InvalidOid,
+	                     ATTSTATSSLOT_VALUES | ATTSTATSSLOT_NUMBERS)) {
+		nmcv = sslot.nvalues;
+		for (int i = 0; i < sslot.nvalues; i++) {
+			mcv_frequency += sslot.numbers[i];
+			if (LeadingKeysMatch(keys, sslot.values[i])) {
+				selectivity += sslot.numbers[i];
+			}
+		}
+		free_attstatsslot(&sslot);
+	}
+
+	double other_frequency = std::max(1.0 - stats->stanullfrac - mcv_frequency, 0.0);
+	if (leading_equality) {
+		if (selectivity == 0) {
+			double ndistinct = stats->stadistinct > 0    ? stats->stadistinct
+			                   : stats->stadistinct < 0 ? -stats->stadistinct * reltuples
+			                                            : DEFAULT_NUM_DISTINCT;
+			selectivity = other_frequency / std::max(ndistinct - nmcv, 1.0);
+		}
+	} else if (get_attstatsslot(&sslot, stats_tuple, STATISTIC_KIND_HISTOGRAM, InvalidOid, ATTSTATSSLOT_VALUES)) {
+		int nmatching = 0;
+		for (int i = 0; i < sslot.nvalues; i++) {
+			nmatching += LeadingKeysMatch(keys, sslot.values[i]);
+		}
+		selectivity += other_frequency * nmatching / std::max(sslot.nvalues, 1);
+		free_attstatsslot(&sslot);
+	} else {
+		selectivity += other_frequency * DEFAULT_INEQ_SEL;
+	}
+
+	ReleaseSysCache(stats_tuple);
+	return selectivity;
+}
+
+bool
+PostgresScanIndexIsUsable(Relation index) {
+	return index->rd_index->indisvalid && !index->rd_index->indcheckxmin &&
+	       heap_attisnull(index->rd_indextuple, Anum_pg_index_indpred, NULL);
+}
+
+/* Read column of the scan with a filter on the key column i of the index, NULL if there is none */
+static const PostgresScanReadColumn *
+IndexColumnFilter(Relation index, int i, const PostgresScanGlobalState &scan_global_state) {
+	AttrNumber heap_attnum = index->rd_index->indkey.values[i];
+	if (heap_attnum <= 0) {
+		return nullptr;
+	}
+	for (const auto &column : scan_global_state.m_deform_read_columns) {
+		if (column.attnum == heap_attnum - 1 && column.filter) {
+			return &column;
+		}
+	}
+	return nullptr;
+}
+
+/* Append the scan keys on the key column i of the index for the comparisons the filter implies */
+static void
+AppendColumnScanKeys(Relation index, int i, Oid atttypid, duckdb::TableFilter &filter,
+                     duckdb::vector<ScanKeyData> &keys) {
+	Oid opfamily = index->rd_opfamily[i];
+	Oid opcintype = index->rd_opcintype[i];
+	if (!IsBinaryCoercible(atttypid, opcintype)) {
+		return;
+	}
+	Oid btree_opclass = GetDefaultOpClass(opcintype, BTREE_AM_OID);
+	if (!OidIsValid(btree_opclass)) {
+		return;
+	}
+	Oid btree_opfamily = get_opclass_family(btree_opclass);
+
+	duckdb::vector<std::pair<StrategyNumber, duckdb::Value>> comparisons;
+	PostgresScanFilterComparisons(filter, comparisons);
+	for (auto &[strategy, constant] : comparisons) {
+		/*
+		 * DuckDB compares strings bytewise while the index orders them by
+		 * its collation, only equality means the same for both.
+		 */
+		if (type_is_collatable(opcintype) && strategy != BTEqualStrategyNumber) {
+			continue;
+		}
+		Oid opr = get_opfamily_member(opfamily, opcintype, opcintype, strategy);
+		if (!OidIsValid(opr) || opr != get_opfamily_member(btree_opfamily, opcintype, opcintype, strategy)) {
+			continue;
+		}
+		Datum datum;
+		if (!PostgresScanFilterConstantDatum(constant, opcintype, datum)) {
+			continue;
+		}
+		ScanKeyData key;
+		ScanKeyEntryInitialize(&key, 0, i + 1, strategy, opcintype, index->rd_indcollation[i], get_opcode(opr),
+		                       datum);
+		keys.push_back(key);
+	}
+}
+
+bool
+PostgresScanIndexScanKeys(Relation index, const PostgresScanGlobalState &scan_global_state,
+                          duckdb::vector<ScanKeyData> &keys) {
+	if (!PostgresScanIndexIsUsable(index)) {
+		return false;
+	}
+
+	for (int i = 0; i < IndexRelationGetNumberOfKeyAttributes(index); i++) {
+		auto read_column = IndexColumnFilter(index, i, scan_global_state);
+		if (read_column) {
+			AppendColumnScanKeys(index, i, read_column->atttypid, *read_column->filter, keys);
+		}
+	}
+	return !keys.empty();
+}
+
+/* The first OR among the conjuncts of the filter, NULL if there is none */
+static duckdb::ConjunctionOrFilter *
+FindOrFilter(duckdb::TableFilter &filter) {
+	switch (filter.filter_type) {
+	case duckdb::TableFilterType::CONJUNCTION_OR:
+		return &filter.Cast<duckdb::ConjunctionOrFilter>();
+	case duckdb::TableFilterType::OPTIONAL_FILTER:
+		return FindOrFilter(*filter.Cast<duckdb::OptionalFilter>().child_filter);
+	case duckdb::TableFilterType::CONJUNCTION_AND:
+		for (auto &child_filter : filter.Cast<duckdb::ConjunctionAndFilter>().child_filters) {
+			auto or_filter = FindOrFilter(*child_filter);
+			if (or_filter) {
+				return or_filter;
+			}
+		}
+		return nullptr;
+	default:
+		return nullptr;
+	}
+}
+
+/*
+ * Sets of scan keys whose index scans together return every row that can
+ * pass the filters. The rows of an OR in the filter of the leading index
+ * column are the union of one scan per disjunct, every disjunct must give
+ * scan keys for that. Keys of each set are in index column order.
+ */
+static bool
+IndexScanKeySets(Relation index, const PostgresScanGlobalState &scan_global_state,
+                 duckdb::vector<duckdb::vector<ScanKeyData>> &key_sets) {
+	duckdb::vector<ScanKeyData> keys;
+	bool has_keys = PostgresScanIndexScanKeys(index, scan_global_state, keys);
+
+	auto read_column = PostgresScanIndexIsUsable(index) ? IndexColumnFilter(index, 0, scan_global_state) : nullptr;
+	auto or_filter = read_column ? FindOrFilter(*read_column->filter) : nullptr;
+	if (or_filter) {
+		duckdb::vector<duckdb::vector<ScanKeyData>> disjunct_key_sets;
+		for (auto &child_filter : or_filter->child_filters) {
+			duckdb::vector<ScanKeyData> disjunct_keys;
+			AppendColumnScanKeys(index, 0, read_column->atttypid, *child_filter, disjunct_keys);
+			if (disjunct_keys.empty()) {
+				break;
+			}
+			disjunct_keys.insert(disjunct_keys.end(), keys.begin(), keys.end());
+			std::stable_sort(disjunct_keys.begin(), disjunct_keys.end(),
+			                 [](const ScanKeyData &a, const ScanKeyData &b) { return a.sk_attno < b.sk_attno; });
+			disjunct_key_sets.push_back(std::move(disjunct_keys));
+		}
+		if (disjunct_key_sets.size() == or_filter->child_filters.size()) {
+			key_sets = std::move(disjunct_key_sets);
+			return true;
+		}
+	}
+
+	if (has_keys) {
+		key_sets.push_back(std::move(keys));
+	}
+	return has_keys;
+}
+
+/*
+ * Whether a bitmap of the index is worth building: BRIN indexes are cheap to
+ * scan, btree indexes only when every key set restricts the leading column
+ * and together they are estimated to select few enough rows.
+ */
+static bool
+UseIndexBitmap(Relation rel, Relation index, const duckdb::vector<duckdb::vector<ScanKeyData>> &key_sets) {
+	if (index->rd_rel->relam == BRIN_AM_OID) {
+		return duckdb_postgres_scan_use_brin;
+	}
+	if (index->rd_rel->relam != BTREE_AM_OID || !duckdb_postgres_scan_use_index) {
+		return false;
+	}
+	double selectivity = 0;
+	for (const auto &keys : key_sets) {
+		if (keys[0].sk_attno != 1) {
+			return false;
+		}
+		selectivity += PostgresScanEstimateIndexSelectivity(rel, index, keys);
+	}
+	return selectivity < PGDUCKDB_BITMAP_SCAN_MAX_SELECTIVITY;
+}
+
+/*
+ * Build a bitmap of every BRIN and selective btree index of the relation that
+ * has scan keys and intersect them. The scans of the key sets of one index
+ * all add to the same bitmap, which makes it their union. Returns NULL when
+ * no index was used.
+ */
+static TIDBitmap *
+IndexBitmap(Relation rel, Snapshot snapshot, const PostgresScanGlobalState *scan_global_state) {
+	TIDBitmap *bitmap = nullptr;
+	List *index_oids = RelationGetIndexList(rel);
+
+	foreach_oid(index_oid, index_oids) {
+		Relation index = index_open(index_oid, AccessShareLock);
+		duckdb::vector<duckdb::vector<ScanKeyData>> key_sets;
+		if (!IndexScanKeySets(index, *scan_global_state, key_sets) || !UseIndexBitmap(rel, index, key_sets)) {
+			index_close(index, AccessShareLock);
+			continue;
+		}
+
+		TIDBitmap *index_bitmap = tbm_create(work_mem * 1024L, NULL);
+		for (auto &keys : key_sets) {
+			IndexScanDesc scan = index_beginscan_bitmap(index, snapshot, keys.size());
+			index_rescan(scan, keys.data(), keys.size(), NULL, 0);
+			index_getbitmap(scan, index_bitmap);
+			index_endscan(scan);
+		}
+		index_close(index, AccessShareLock);
+
+		if (bitmap) {
+			tbm_intersect(bitmap, index_bitmap);
+			tbm_free(index_bitmap);
+		} else {
+			bitmap = index_bitmap;
+		}
+	}
+
+	list_free(index_oids);
+	return bitmap;
+}
+
+static void
+BitmapBlocks(TIDBitmap *bitmap, duckdb::vector<BlockNumber> *blocks) {
+	TBMIterator *iterator = tbm_begin_iterate(bitmap);
+	TBMIterateResult *result;
+	while ((result = tbm_iterate(iterator)) != NULL) {
+		blocks->push_back(result->blockno);
+	}
+	tbm_end_iterate(iterator);
+	tbm_free(bitmap);
+}
+
+bool
+PostgresScanBitmapBlocks(Relation rel, Snapshot snapshot, const PostgresScanGlobalState &scan_global_state,
+                         duckdb::vector<BlockNumber> &blocks) {
+	if ((!duckdb_postgres_scan_use_brin && !duckdb_postgres_scan_use_index) || !scan_global_state.m_filters ||
+	    !rel->rd_rel->relhasindex) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+	TIDBitmap *bitmap = PostgresFunctionGuard<TIDBitmap *>(IndexBitmap, rel, snapshot, &scan_global_state);
+	if (!bitmap) {
+		return false;
+	}
+	PostgresFunctionGuard(BitmapBlocks, bitmap, &blocks);
+	return true;
+}
+
+/*
+ * Build the constant comparisons of the pushed down filters as clauses on the
+ * columns of the relation and try to refute its partition constraint with
+ * them, as constraint exclusion does.
+ */
+static bool
+PartitionExcluded(Relation partition, const PostgresScanGlobalState *scan_global_state) {
+	List *partition_qual = RelationGetPartitionQual(partition);
+	List *clauses = NIL;
+	if (partition_qual == NIL) {
+		return false;
+	}
+
+	for (const auto &read_column : scan_global_state->m_deform_read_columns) {
+		if (!read_column.filter) {
+			continue;
+		}
+		Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(partition), read_column.attnum);
+		Oid btree_opclass = GetDefaultOpClass(attr->atttypid, BTREE_AM_OID);
+		if (!OidIsValid(btree_opclass)) {
+			continue;
+		}
+		Oid btree_opfamily = get_opclass_family(btree_opclass);
+
+		duckdb::vector<std::pair<StrategyNumber, duckdb::Value>> comparisons;
+		PostgresScanFilterComparisons(*read_column.filter, comparisons);
+		for (auto &[strategy, constant] : comparisons) {
+			/* As for index scan keys, only equality means the same for DuckDB and the column collation */
+			if (type_is_collatable(attr->atttypid) && strategy != BTEqualStrategyNumber) {
+				continue;
+			}
+			Datum datum;
+			Oid opr = get_opfamily_member(btree_opfamily, attr->atttypid, attr->atttypid, strategy);
+			if (!OidIsValid(opr) || !PostgresScanFilterConstantDatum(constant, attr->atttypid, datum)) {
+				continue;
+			}
+			Var *var = makeVar(1, read_column.attnum + 1, attr->atttypid, attr->atttypmod, attr->attcollation, 0);
+			Const *value =
+			    makeConst(attr->atttypid, -1, attr->attcollation, attr->attlen, datum, false, attr->attbyval);
+			clauses = lappend(clauses, make_opclause(opr, BOOLOID, false, (Expr *)var, (Expr *)value, InvalidOid,
+			                                         attr->attcollation));
+		}
+	}
+
+	return clauses != NIL && predicate_refuted_by(partition_qual, clauses, false);
+}
+
+bool
+PostgresScanPartitionExcluded(Relation partition, const PostgresScanGlobalState &scan_global_state) {
+	if (!scan_global_state.m_filters || !partition->rd_rel->relispartition) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+	return PostgresFunctionGuard<bool>(PartitionExcluded, partition, &scan_global_state);
+}
+
+} // namespace pgduckdb
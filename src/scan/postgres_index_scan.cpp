@@ -0,0 +1,440 @@
+#include "duckdb.hpp"
+
+extern "C" {
+#include "postgres.h"
+#include "miscadmin.h"
+#include "access/genam.h"
+#include "access/relscan.h"
+#include "access/stratnum.h"
+#include "access/tableam.h"
+#include "access/visibilitymap.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_index.h"
+#include "catalog/pg_type.h"
+#include "commands/defrem.h"
+#include "catalog/index.h"
+#include "executor/tuptable.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/relcache.h"
+}
+
+#include "pgduckdb/pgduckdb.h"
+#include "pgduckdb/pgduckdb_process_lock.hpp"
+#include "pgduckdb/pgduckdb_types.hpp"
+#include "pgduckdb/pgduckdb_utils.hpp"
+#include "pgduckdb/scan/postgres_index_pruning.hpp"
+#include "pgduckdb/scan/postgres_index_scan.hpp"
+#include "pgduckdb/vendor/pg_list.hpp"
+
+namespace pgduckdb {
+
+/* Largest estimated fraction of the rows for which an index scan is used instead of the heap scan */
+#define PGDUCKDB_INDEX_SCAN_MAX_SELECTIVITY 0.01
+
+/*
+ * Open the btree index with scan keys on its leading column that is estimated
+ * to select the fewest rows, if that is below the threshold.
+ */
+static Relation
+ChooseBtreeIndex(Relation rel, const PostgresScanGlobalState *scan_global_state, duckdb::vector<ScanKeyData> *keys) {
+	Relation best_index = nullptr;
+	double best_selectivity = PGDUCKDB_INDEX_SCAN_MAX_SELECTIVITY;
+	List *index_oids = RelationGetIndexList(rel);
+
+	foreach_oid(index_oid, index_oids) {
+		Relation index = index_open(index_oid, AccessShareLock);
+		duckdb::vector<ScanKeyData> index_keys;
+		if (index->rd_rel->relam != BTREE_AM_OID || !index->rd_index->indisvalid ||
+		    !PostgresScanIndexScanKeys(index, *scan_global_state, index_keys) || index_keys[0].sk_attno != 1) {
+			index_close(index, AccessShareLock);
+			continue;
+		}
+
+		double selectivity = PostgresScanEstimateIndexSelectivity(rel, index, index_keys);
+		if (selectivity >= best_selectivity) {
+			index_close(index, AccessShareLock);
+			continue;
+		}
+		if (best_index) {
+			index_close(best_index, AccessShareLock);
+		}
+		best_index = index;
+		best_selectivity = selectivity;
+		*keys = std::move(index_keys);
+	}
+
+	list_free(index_oids);
+	return best_index;
+}
+
+/*
+ * Whether every column the scan reads can be returned by the index, as key or
+ * INCLUDE column of the same type as the table column. Indexes with
+ * expression columns are not used, their values have no table column to go
+ * to. Neither are scans that emit the rowid: the index TID of a HOT chain is
+ * its root, not the ctid of the visible row. That includes COUNT(*) scans,
+ * which look the same as scans of the rowid alone, so they read the heap.
+ */
+static bool
+IndexCoversScan(Relation index, const PostgresScanGlobalState *scan_global_state) {
+	if (scan_global_state->m_emit_rowid) {
+		return false;
+	}
+	for (int i = 0; i < IndexRelationGetNumberOfAttributes(index); i++) {
+		if (index->rd_index->indkey.values[i] == 0) {
+			return false;
+		}
+	}
+
+	TupleDesc index_desc = RelationGetDescr(index);
+	for (const auto &read_column : scan_global_state->m_deform_read_columns) {
+		bool covered = false;
+		for (int i = 0; i < IndexRelationGetNumberOfAttributes(index) && !covered; i++) {
+			covered = index->rd_index->indkey.values[i] == read_column.attnum + 1 && index_can_return(index, i + 1) &&
+			          TupleDescAttr(index_desc, i)->atttypid == read_column.atttypid;
+		}
+		if (!covered) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * Open the smallest btree index that covers the scan, when reading it instead
+ * of the heap pays off: the index is at most half the size of the table and
+ * at least half of the table is all-visible, so most rows come from the index
+ * alone. Filters on its columns become scan keys.
+ */
+static Relation
+ChooseCoveringIndex(Relation rel, const PostgresScanGlobalState *scan_global_state, duckdb::vector<ScanKeyData> *keys) {
+	Relation best_index = nullptr;
+	BlockNumber heap_pages = rel->rd_rel->relpages;
+	if (heap_pages == 0 || (BlockNumber)rel->rd_rel->relallvisible * 2 < heap_pages) {
+		return nullptr;
+	}
+	List *index_oids = RelationGetIndexList(rel);
+
+	foreach_oid(index_oid, index_oids) {
+		Relation index = index_open(index_oid, AccessShareLock);
+		if (index->rd_rel->relam != BTREE_AM_OID || !PostgresScanIndexIsUsable(index) ||
+		    (BlockNumber)index->rd_rel->relpages * 2 > heap_pages || !IndexCoversScan(index, scan_global_state) ||
+		    (best_index && index->rd_rel->relpages >= best_index->rd_rel->relpages)) {
+			index_close(index, AccessShareLock);
+			continue;
+		}
+		if (best_index) {
+			index_close(best_index, AccessShareLock);
+		}
+		best_index = index;
+	}
+
+	list_free(index_oids);
+	if (best_index && scan_global_state->m_filters) {
+		PostgresScanIndexScanKeys(best_index, *scan_global_state, *keys);
+	}
+	return best_index;
+}
+
+/*
+ * Whether the btree order of the leading index column is the order DuckDB
+ * sorts the column in. That holds for the default btree opclass of types
+ * converted to DuckDB types of the same order, NaN sorts last in both.
+ */
+static bool
+OrderMatchesDuckDB(Relation index) {
+	Oid type_oid = TupleDescAttr(RelationGetDescr(index), 0)->atttypid;
+	switch (type_oid) {
+	case BOOLOID:
+	case INT2OID:
+	case INT4OID:
+	case INT8OID:
+	case FLOAT4OID:
+	case FLOAT8OID:
+	case DATEOID:
+	case TIMESTAMPOID:
+	case TIMESTAMPTZOID:
+		break;
+	default:
+		return false;
+	}
+	return index->rd_opfamily[0] == get_opclass_family(GetDefaultOpClass(type_oid, BTREE_AM_OID));
+}
+
+/*
+ * Open the smallest btree index that leads with the order column, filters on
+ * its columns become scan keys.
+ */
+static Relation
+ChooseOrderedIndex(Relation rel, const PostgresScanGlobalState *scan_global_state, const PostgresScanOrder *order,
+                   duckdb::vector<ScanKeyData> *keys) {
+	Relation best_index = nullptr;
+	List *index_oids = RelationGetIndexList(rel);
+
+	foreach_oid(index_oid, index_oids) {
+		Relation index = index_open(index_oid, AccessShareLock);
+		if (index->rd_rel->relam != BTREE_AM_OID || !PostgresScanIndexIsUsable(index) ||
+		    index->rd_index->indkey.values[0] != order->m_attnum + 1 || !OrderMatchesDuckDB(index) ||
+		    (best_index && index->rd_rel->relpages >= best_index->rd_rel->relpages)) {
+			index_close(index, AccessShareLock);
+			continue;
+		}
+		if (best_index) {
+			index_close(best_index, AccessShareLock);
+		}
+		best_index = index;
+	}
+
+	list_free(index_oids);
+	if (best_index && scan_global_state->m_filters) {
+		PostgresScanIndexScanKeys(best_index, *scan_global_state, *keys);
+	}
+	return best_index;
+}
+
+/*
+ * An ordered scan reads an index on the order column. Otherwise a selective
+ * index is preferred, read index-only if it covers the scan, and else a
+ * covering index replaces the heap scan when it is small enough.
+ */
+static Relation
+ChooseIndex(Relation rel, const PostgresScanGlobalState *scan_global_state, const PostgresScanOrder *order,
+            duckdb::vector<ScanKeyData> *keys, bool *index_only, bool *ordered) {
+	Relation index = order ? ChooseOrderedIndex(rel, scan_global_state, order, keys) : nullptr;
+	*ordered = index != nullptr;
+	if (!index && scan_global_state->m_filters) {
+		index = ChooseBtreeIndex(rel, scan_global_state, keys);
+	}
+	if (index) {
+		*index_only = IndexCoversScan(index, scan_global_state);
+		return index;
+	}
+	index = ChooseCoveringIndex(rel, scan_global_state, keys);
+	*index_only = index != nullptr;
+	return index;
+}
+
+static void
+BeginIndexScan(PostgresIndexScan *index_scan, Snapshot snapshot, duckdb::vector<ScanKeyData> *keys) {
+	index_scan->m_scan = index_beginscan(index_scan->m_rel, index_scan->m_index, snapshot, keys->size(), 0);
+	if (index_scan->m_index_only) {
+		int natts = RelationGetDescr(index_scan->m_rel)->natts;
+		index_scan->m_scan->xs_want_itup = true;
+		index_scan->m_heap_values = (Datum *)palloc0(sizeof(Datum) * natts);
+		index_scan->m_heap_nulls = (bool *)palloc(sizeof(bool) * natts);
+		memset(index_scan->m_heap_nulls, true, sizeof(bool) * natts);
+	}
+	index_rescan(index_scan->m_scan, keys->data(), keys->size(), NULL, 0);
+	index_scan->m_slot = table_slot_create(index_scan->m_rel, NULL);
+	index_scan->m_batch_context =
+	    AllocSetContextCreate(CurrentMemoryContext, "PostgresIndexScanBatch", ALLOCSET_DEFAULT_SIZES);
+}
+
+static void
+RescanIndex(PostgresIndexScan *index_scan, duckdb::vector<ScanKeyData> *keys) {
+	index_rescan(index_scan->m_scan, keys->data(), keys->size(), NULL, 0);
+}
+
+/*
+ * Key sets that return the rows of an ordered scan in the wanted order, one
+ * pass each. The index may place NULLs differently in the scan direction, so
+ * NULLs and other values are read in separate passes with an IS NULL or IS
+ * NOT NULL key on the leading column. Returns the scan direction.
+ */
+static ScanDirection
+OrderedKeySets(Relation index, const PostgresScanOrder &order, const duckdb::vector<ScanKeyData> &keys,
+               duckdb::vector<duckdb::vector<ScanKeyData>> &key_sets) {
+	for (int pass = 0; pass < 2; pass++) {
+		bool nulls = (pass == 0) == order.m_nulls_first;
+		if (nulls && order.m_skip_nulls) {
+			continue;
+		}
+		duckdb::vector<ScanKeyData> key_set(1);
+		ScanKeyEntryInitialize(&key_set[0], SK_ISNULL | (nulls ? SK_SEARCHNULL : SK_SEARCHNOTNULL), 1,
+		                       InvalidStrategy, InvalidOid, InvalidOid, InvalidOid, (Datum)0);
+		key_set.insert(key_set.end(), keys.begin(), keys.end());
+		key_sets.push_back(std::move(key_set));
+	}
+	bool index_desc = (index->rd_indoption[0] & INDOPTION_DESC) != 0;
+	return order.m_desc == index_desc ? ForwardScanDirection : BackwardScanDirection;
+}
+
+static void
+EndIndexScan(PostgresIndexScan *index_scan) {
+	if (index_scan->m_scan) {
+		index_endscan(index_scan->m_scan);
+	}
+	if (index_scan->m_slot) {
+		ExecDropSingleTupleTableSlot(index_scan->m_slot);
+	}
+	if (index_scan->m_batch_context) {
+		MemoryContextDelete(index_scan->m_batch_context);
+	}
+	if (index_scan->m_vmbuffer != InvalidBuffer) {
+		ReleaseBuffer(index_scan->m_vmbuffer);
+	}
+	index_close(index_scan->m_index, NoLock);
+}
+
+/*
+ * Like IndexOnlyNext: rows on all-visible heap pages are formed from the
+ * values of the index tuple, as heap tuple of the table with NULL for the
+ * columns the scan does not read. Other rows are fetched from the heap, which
+ * also checks their visibility.
+ */
+static int
+FetchIndexOnlyTuples(PostgresIndexScan *index_scan, HeapTupleData *tuples, int max_tuples) {
+	IndexScanDesc scan = index_scan->m_scan;
+	Datum index_values[INDEX_MAX_KEYS];
+	bool index_nulls[INDEX_MAX_KEYS];
+	int ntuples = 0;
+	ItemPointer tid;
+
+	while (ntuples < max_tuples && (tid = index_getnext_tid(scan, index_scan->m_direction)) != NULL) {
+		if (!VM_ALL_VISIBLE(index_scan->m_rel, ItemPointerGetBlockNumber(tid), &index_scan->m_vmbuffer)) {
+			if (index_fetch_heap(scan, index_scan->m_slot)) {
+				tuples[ntuples++] = *ExecCopySlotHeapTuple(index_scan->m_slot);
+			}
+			continue;
+		}
+
+		index_deform_tuple(scan->xs_itup, scan->xs_itupdesc, index_values, index_nulls);
+		for (int i = 0; i < scan->xs_itupdesc->natts; i++) {
+			int attnum = index_scan->m_index->rd_index->indkey.values[i] - 1;
+			index_scan->m_heap_values[attnum] = index_values[i];
+			index_scan->m_heap_nulls[attnum] = index_nulls[i];
+		}
+		HeapTuple tuple =
+		    heap_form_tuple(RelationGetDescr(index_scan->m_rel), index_scan->m_heap_values, index_scan->m_heap_nulls);
+		tuple->t_self = *tid;
+		tuple->t_tableOid = RelationGetRelid(index_scan->m_rel);
+		tuples[ntuples++] = *tuple;
+	}
+	return ntuples;
+}
+
+/*
+ * Copy the next heap tuples the index scan returns into the batch memory
+ * context, the tuples of the previous batch are freed first.
+ */
+static int
+FetchIndexBatch(PostgresIndexScan *index_scan, HeapTupleData *tuples, int max_tuples) {
+	MemoryContextReset(index_scan->m_batch_context);
+	MemoryContext old_context = MemoryContextSwitchTo(index_scan->m_batch_context);
+	int ntuples = 0;
+	if (index_scan->m_index_only) {
+		ntuples = FetchIndexOnlyTuples(index_scan, tuples, max_tuples);
+	} else {
+		while (ntuples < max_tuples &&
+		       index_getnext_slot(index_scan->m_scan, index_scan->m_direction, index_scan->m_slot)) {
+			tuples[ntuples++] = *ExecCopySlotHeapTuple(index_scan->m_slot);
+		}
+	}
+	MemoryContextSwitchTo(old_context);
+	return ntuples;
+}
+
+//
+// PostgresIndexScan
+//
+
+PostgresIndexScan::PostgresIndexScan(Relation rel, Relation index,
+                                     duckdb::shared_ptr<PostgresScanGlobalState> global_state)
+    : m_rel(rel), m_index(index), m_index_only(false), m_direction(ForwardScanDirection), m_scan(nullptr),
+      m_slot(nullptr), m_batch_context(nullptr), m_vmbuffer(InvalidBuffer), m_heap_values(nullptr),
+      m_heap_nulls(nullptr), m_global_state(global_state), m_key_set(0), m_limit(0), m_nreturned(0),
+      m_exhausted(false) {
+}
+
+PostgresIndexScan::~PostgresIndexScan() {
+	std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+	EndIndexScan(this);
+}
+
+duckdb::unique_ptr<PostgresIndexScan>
+PostgresIndexScan::Create(Relation rel, Snapshot snapshot, duckdb::shared_ptr<PostgresScanGlobalState> global_state,
+                          const PostgresScanOrder *order) {
+	if (!duckdb_postgres_scan_use_index || !rel->rd_rel->relhasindex) {
+		return nullptr;
+	}
+
+	duckdb::vector<ScanKeyData> keys;
+	Relation index;
+	bool index_only;
+	bool ordered;
+	{
+		std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+		index = PostgresFunctionGuard<Relation>(ChooseIndex, rel, global_state.get(), order, &keys, &index_only,
+		                                        &ordered);
+	}
+	if (!index) {
+		return nullptr;
+	}
+
+	/* The destructor takes DuckdbProcessLock itself when starting the scan fails */
+	auto index_scan = duckdb::make_uniq<PostgresIndexScan>(rel, index, global_state);
+	index_scan->m_index_only = index_only;
+	if (ordered) {
+		index_scan->m_direction = OrderedKeySets(index, *order, keys, index_scan->m_key_sets);
+		index_scan->m_limit = order->m_limit;
+	} else {
+		index_scan->m_key_sets.push_back(std::move(keys));
+	}
+	{
+		std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+		PostgresFunctionGuard(BeginIndexScan, index_scan.get(), snapshot, &index_scan->m_key_sets[0]);
+	}
+	/* Tuples are copies that only live until the next batch */
+	global_state->m_zero_copy_strings = false;
+	return index_scan;
+}
+
+/*
+ * Fill the output chunk from the index scan, returns false once the scan is
+ * exhausted. The output may still hold the last rows then.
+ */
+bool
+PostgresIndexScan::ReadTuples(duckdb::DataChunk &output, duckdb::shared_ptr<PostgresScanLocalState> local_state) {
+	std::lock_guard<std::mutex> scan_lock(m_lock);
+
+	while (!m_exhausted && local_state->m_output_vector_size < (int)STANDARD_VECTOR_SIZE) {
+		int max_tuples =
+		    std::min(PGDUCKDB_SCAN_BATCH_SIZE, (int)STANDARD_VECTOR_SIZE - local_state->m_output_vector_size);
+		if (m_limit) {
+			max_tuples = (int)std::min<idx_t>(max_tuples, m_limit - m_nreturned);
+		}
+		int ntuples;
+		{
+			std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+			ntuples = PostgresFunctionGuard<int>(FetchIndexBatch, this, m_batch_tuples, max_tuples);
+			if (ntuples < max_tuples && !QueryCancelPending && m_key_set + 1 < m_key_sets.size()) {
+				m_key_set++;
+				PostgresFunctionGuard(RescanIndex, this, &m_key_sets[m_key_set]);
+			} else if (ntuples < max_tuples || QueryCancelPending) {
+				m_exhausted = true;
+			}
+		}
+		if (ntuples > 0) {
+			int nrows = local_state->m_output_vector_size;
+			local_state->m_batch_buffer = InvalidBuffer;
+			InsertTuplesIntoChunk(output, m_global_state, local_state, m_batch_tuples, ntuples);
+			m_nreturned += local_state->m_output_vector_size - nrows;
+		}
+		if (m_limit && m_nreturned >= m_limit) {
+			m_exhausted = true;
+		}
+	}
+
+	if (local_state->m_output_vector_size) {
+		FinalizeOutputChunk(output, local_state, local_state->m_output_vector_size);
+		output.SetCardinality(local_state->m_output_vector_size);
+		output.Verify();
+		local_state->m_output_vector_size = 0;
+	}
+
+	return !m_exhausted;
+}
+
+} // namespace pgduckdb
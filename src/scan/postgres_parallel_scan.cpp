@@ -0,0 +1,382 @@
+#include "duckdb.hpp"
+
+extern "C" {
+#include "postgres.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "access/heapam.h"
+#include "access/parallel.h"
+#include "access/table.h"
+#include "access/xact.h"
+#include "optimizer/paths.h"
+#include "port/atomics.h"
+#include "storage/bufmgr.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+}
+
+#include "pgduckdb/pgduckdb.h"
+#include "pgduckdb/pgduckdb_process_lock.hpp"
+#include "pgduckdb/pgduckdb_types.hpp"
+#include "pgduckdb/pgduckdb_utils.hpp"
+#include "pgduckdb/scan/postgres_parallel_scan.hpp"
+
+#include <chrono>
+#include <thread>
+
+/* shm_toc keys of the scan state, the snapshot and the tuple queues */
+#define PGDUCKDB_PARALLEL_KEY_SCAN     UINT64CONST(0xD0C4DB0000000001)
+#define PGDUCKDB_PARALLEL_KEY_SNAPSHOT UINT64CONST(0xD0C4DB0000000002)
+#define PGDUCKDB_PARALLEL_KEY_QUEUES   UINT64CONST(0xD0C4DB0000000003)
+
+/* Time a thread sleeps when no worker had tuples waiting */
+#define PGDUCKDB_PARALLEL_SCAN_POLL_INTERVAL std::chrono::microseconds(100)
+/* Size of the tuple queue of every worker, the one Gather uses */
+#define PGDUCKDB_PARALLEL_SCAN_QUEUE_SIZE (64 * 1024)
+/* Blocks a worker claims at a time */
+#define PGDUCKDB_PARALLEL_SCAN_CHUNK_SIZE 16
+/* Every message starts with the ctid of the tuple, padded so the tuple is MAXALIGNed */
+#define PGDUCKDB_PARALLEL_SCAN_TID_SIZE MAXALIGN(sizeof(ItemPointerData))
+
+/* Scan state shared with the workers */
+struct PostgresParallelScanShared {
+	Oid m_relid;
+	BlockNumber m_start_block;
+	uint64 m_nblocks;
+	/* Only ctids are sent, for a COUNT(*) */
+	bool m_count_tuples_only;
+	pg_atomic_uint64 m_nallocated;
+};
+
+namespace pgduckdb {
+
+//
+// Backend
+//
+
+/*
+ * Enter parallel mode and launch the workers, with one queue each. The
+ * context and queue handles live in TopTransactionContext, so they are
+ * cleaned up with the transaction when it aborts.
+ */
+static void
+LaunchWorkers(PostgresParallelScan *scan, Relation rel, Snapshot snapshot, BlockNumber start_block,
+              BlockNumber end_block) {
+	MemoryContext old_context = MemoryContextSwitchTo(TopTransactionContext);
+	EnterParallelMode();
+	/* The DSM segment holds a queue per requested worker, more than max_parallel_workers never launch */
+	int nworkers = Min(duckdb_postgres_scan_parallel_workers, max_parallel_workers);
+	ParallelContext *pcxt = CreateParallelContext("pg_duckdb", "PostgresParallelScanWorkerMain", nworkers);
+	scan->m_pcxt = pcxt;
+
+	Size snapshot_size = EstimateSnapshotSpace(snapshot);
+	Size queues_size = mul_size(PGDUCKDB_PARALLEL_SCAN_QUEUE_SIZE, pcxt->nworkers);
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(PostgresParallelScanShared));
+	shm_toc_estimate_chunk(&pcxt->estimator, snapshot_size);
+	shm_toc_estimate_chunk(&pcxt->estimator, queues_size);
+	shm_toc_estimate_keys(&pcxt->estimator, 3);
+	InitializeParallelDSM(pcxt);
+
+	auto shared = (PostgresParallelScanShared *)shm_toc_allocate(pcxt->toc, sizeof(PostgresParallelScanShared));
+	shared->m_relid = RelationGetRelid(rel);
+	shared->m_start_block = start_block;
+	shared->m_nblocks = end_block - start_block;
+	shared->m_count_tuples_only = scan->m_count_tuples_only;
+	pg_atomic_init_u64(&shared->m_nallocated, 0);
+	shm_toc_insert(pcxt->toc, PGDUCKDB_PARALLEL_KEY_SCAN, shared);
+
+	char *snapshot_space = (char *)shm_toc_allocate(pcxt->toc, snapshot_size);
+	SerializeSnapshot(snapshot, snapshot_space);
+	shm_toc_insert(pcxt->toc, PGDUCKDB_PARALLEL_KEY_SNAPSHOT, snapshot_space);
+
+	char *queue_space = (char *)shm_toc_allocate(pcxt->toc, queues_size);
+	shm_toc_insert(pcxt->toc, PGDUCKDB_PARALLEL_KEY_QUEUES, queue_space);
+
+	/* Without a DSM segment there are no workers either */
+	if (pcxt->seg && pcxt->nworkers > 0) {
+		for (int i = 0; i < pcxt->nworkers; i++) {
+			shm_mq *mq = shm_mq_create(queue_space + (Size)i * PGDUCKDB_PARALLEL_SCAN_QUEUE_SIZE,
+			                           PGDUCKDB_PARALLEL_SCAN_QUEUE_SIZE);
+			shm_mq_set_receiver(mq, MyProc);
+			scan->m_queues.push_back(shm_mq_attach(mq, pcxt->seg, NULL));
+		}
+		LaunchParallelWorkers(pcxt);
+		elog(DEBUG1, "(PGDuckDB/PostgresParallelScan) Launched %d of %d parallel workers", pcxt->nworkers_launched,
+		     pcxt->nworkers);
+		/* Workers are launched in order, the queues of the others are never used */
+		scan->m_queues.resize(pcxt->nworkers_launched);
+		for (int i = 0; i < pcxt->nworkers_launched; i++) {
+			shm_mq_set_handle(scan->m_queues[i], pcxt->worker[i].bgwhandle);
+		}
+	}
+	scan->m_nattached = scan->m_queues.size();
+	MemoryContextSwitchTo(old_context);
+}
+
+/* Wait for the workers, which reports their errors, and leave parallel mode */
+static void
+FinishWorkers(PostgresParallelScan *scan) {
+	if (scan->m_pcxt->nworkers_launched > 0) {
+		WaitForParallelWorkersToFinish(scan->m_pcxt);
+	}
+	DestroyParallelContext(scan->m_pcxt);
+	scan->m_pcxt = NULL;
+	ExitParallelMode();
+}
+
+/*
+ * Receive up to max_tuples tuples into the batch, taking turns over the
+ * queues, without waiting for any. Once all workers detached the scan is
+ * exhausted. Cancel interrupts are held while DuckDB runs the query, so a
+ * pending cancel is raised here, or the scan would keep reading until the
+ * workers are done.
+ */
+static int
+ReceiveTuples(PostgresParallelScan *scan, PostgresParallelScanBatch *batch, int max_tuples) {
+	CHECK_FOR_INTERRUPTS();
+	if (QueryCancelPending) {
+		ereport(ERROR, (errcode(ERRCODE_QUERY_CANCELED), errmsg("canceling statement due to user request")));
+	}
+	if (ParallelMessagePending) {
+		HandleParallelMessages();
+	}
+
+	int ntuples = 0;
+	duckdb::idx_t nqueues = scan->m_queues.size();
+	batch->m_data.clear();
+	for (duckdb::idx_t i = 0; i < nqueues && ntuples < max_tuples; i++) {
+		duckdb::idx_t queue = (scan->m_next_queue + i) % nqueues;
+		while (scan->m_queues[queue] && ntuples < max_tuples) {
+			Size nbytes;
+			void *data;
+			shm_mq_result result = shm_mq_receive(scan->m_queues[queue], &nbytes, &data, true);
+			if (result == SHM_MQ_WOULD_BLOCK) {
+				break;
+			}
+			if (result == SHM_MQ_DETACHED) {
+				shm_mq_detach(scan->m_queues[queue]);
+				scan->m_queues[queue] = NULL;
+				scan->m_nattached--;
+				break;
+			}
+			duckdb::idx_t offset = MAXALIGN(batch->m_data.size());
+			batch->m_data.resize(offset + nbytes);
+			memcpy(batch->m_data.data() + offset, data, nbytes);
+			batch->m_offsets[ntuples] = offset;
+			batch->m_tuples[ntuples].t_len = nbytes - PGDUCKDB_PARALLEL_SCAN_TID_SIZE;
+			ntuples++;
+		}
+	}
+	if (nqueues > 0) {
+		scan->m_next_queue = (scan->m_next_queue + 1) % nqueues;
+	}
+
+	/* The copies are only addressed once m_data stopped growing */
+	for (int i = 0; i < ntuples; i++) {
+		char *message = batch->m_data.data() + batch->m_offsets[i];
+		HeapTupleData &tuple = batch->m_tuples[i];
+		memcpy(&tuple.t_self, message, sizeof(ItemPointerData));
+		tuple.t_data = tuple.t_len > 0 ? (HeapTupleHeader)(message + PGDUCKDB_PARALLEL_SCAN_TID_SIZE) : NULL;
+		tuple.t_tableOid = scan->m_relid;
+	}
+
+	if (ntuples == 0 && scan->m_nattached == 0) {
+		FinishWorkers(scan);
+		scan->m_exhausted = true;
+	}
+	return ntuples;
+}
+
+//
+// PostgresParallelScan
+//
+
+PostgresParallelScan::PostgresParallelScan(Relation rel, duckdb::shared_ptr<PostgresScanGlobalState> global_state)
+    : m_pcxt(nullptr), m_nattached(0), m_next_queue(0), m_exhausted(false),
+      m_count_tuples_only(global_state->m_count_tuples_only), m_relid(RelationGetRelid(rel)),
+      m_global_state(global_state) {
+}
+
+/*
+ * After an abort the transaction already destroyed the parallel context and
+ * left parallel mode, the context must not be touched anymore then.
+ */
+PostgresParallelScan::~PostgresParallelScan() {
+	std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+	if (m_pcxt && IsInParallelMode()) {
+		DestroyParallelContext(m_pcxt);
+		ExitParallelMode();
+	}
+}
+
+duckdb::unique_ptr<PostgresParallelScan>
+PostgresParallelScan::Create(Relation rel, Snapshot snapshot, duckdb::shared_ptr<PostgresScanGlobalState> global_state,
+                             BlockNumber start_block, BlockNumber end_block, bool parallel_safe) {
+	if (!parallel_safe || duckdb_postgres_scan_parallel_workers == 0 || RelationUsesLocalBuffers(rel) ||
+	    end_block - start_block < (BlockNumber)min_parallel_table_scan_size) {
+		return nullptr;
+	}
+
+	/* The destructor takes DuckdbProcessLock itself when no worker was launched */
+	auto parallel_scan = duckdb::make_uniq<PostgresParallelScan>(rel, global_state);
+	bool launched;
+	{
+		std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+		/* Another scan of the query already runs workers */
+		launched = !IsInParallelMode();
+		if (launched) {
+			PostgresFunctionGuard(LaunchWorkers, parallel_scan.get(), rel, snapshot, start_block, end_block);
+		}
+	}
+	if (!launched || parallel_scan->m_queues.empty()) {
+		return nullptr;
+	}
+	return parallel_scan;
+}
+
+bool
+PostgresParallelScan::ReadTuples(duckdb::DataChunk &output, duckdb::shared_ptr<PostgresScanLocalState> local_state,
+                                 PostgresParallelScanBatch &batch) {
+	bool exhausted = false;
+
+	while (local_state->m_output_vector_size < (int)STANDARD_VECTOR_SIZE) {
+		int max_tuples =
+		    std::min(PGDUCKDB_SCAN_BATCH_SIZE, (int)STANDARD_VECTOR_SIZE - local_state->m_output_vector_size);
+		int ntuples = 0;
+		{
+			std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+			exhausted = m_exhausted;
+			if (!exhausted) {
+				ntuples = PostgresFunctionGuard<int>(ReceiveTuples, this, &batch, max_tuples);
+				exhausted = m_exhausted;
+			}
+		}
+		if (exhausted) {
+			break;
+		}
+		/*
+		 * An empty chunk would end the scan, so only return once it has rows.
+		 * Other threads can use DuckdbProcessLock while this one waits.
+		 */
+		if (ntuples == 0) {
+			if (local_state->m_output_vector_size > 0) {
+				break;
+			}
+			std::this_thread::sleep_for(PGDUCKDB_PARALLEL_SCAN_POLL_INTERVAL);
+			continue;
+		}
+		if (m_global_state->m_count_tuples_only && m_global_state->m_emit_rowid) {
+			auto rowids = duckdb::FlatVector::GetData<int64_t>(output.data[0]);
+			for (int i = 0; i < ntuples; i++) {
+				rowids[local_state->m_output_vector_size + i] =
+				    PostgresScanEncodeRowId(ItemPointerGetBlockNumber(&batch.m_tuples[i].t_self),
+				                            ItemPointerGetOffsetNumber(&batch.m_tuples[i].t_self));
+			}
+		}
+		local_state->m_batch_buffer = InvalidBuffer;
+		InsertTuplesIntoChunk(output, m_global_state, local_state, batch.m_tuples, ntuples);
+	}
+
+	if (local_state->m_output_vector_size) {
+		FinalizeOutputChunk(output, local_state, local_state->m_output_vector_size);
+		output.SetCardinality(local_state->m_output_vector_size);
+		output.Verify();
+		local_state->m_output_vector_size = 0;
+	}
+
+	return !exhausted;
+}
+
+} // namespace pgduckdb
+
+//
+// Worker
+//
+
+/*
+ * Scan chunks of the block range and send the visible tuples of every block
+ * to the backend, like heapam's heapgetpage decides them. The content lock is
+ * released before sending, the pin keeps the tuples in place. Stops early
+ * when the backend detached from the queue.
+ */
+void
+PostgresParallelScanWorkerMain(dsm_segment *seg, shm_toc *toc) {
+	auto shared = (PostgresParallelScanShared *)shm_toc_lookup(toc, PGDUCKDB_PARALLEL_KEY_SCAN, false);
+	Snapshot snapshot = RestoreSnapshot((char *)shm_toc_lookup(toc, PGDUCKDB_PARALLEL_KEY_SNAPSHOT, false));
+	char *queue_space = (char *)shm_toc_lookup(toc, PGDUCKDB_PARALLEL_KEY_QUEUES, false);
+	shm_mq *mq = (shm_mq *)(queue_space + (Size)ParallelWorkerNumber * PGDUCKDB_PARALLEL_SCAN_QUEUE_SIZE);
+	shm_mq_set_sender(mq, MyProc);
+	shm_mq_handle *mqh = shm_mq_attach(mq, seg, NULL);
+
+	Relation rel = table_open(shared->m_relid, AccessShareLock);
+	BufferAccessStrategy strategy = GetAccessStrategy(BAS_BULKREAD);
+	OffsetNumber page_tuples[MaxHeapTuplesPerPage];
+	char header[PGDUCKDB_PARALLEL_SCAN_TID_SIZE];
+	bool detached = false;
+	uint64 position = 0;
+	uint64 chunk_remaining = 0;
+
+	memset(header, 0, sizeof(header));
+	while (!detached) {
+		if (chunk_remaining == 0) {
+			position = pg_atomic_fetch_add_u64(&shared->m_nallocated, PGDUCKDB_PARALLEL_SCAN_CHUNK_SIZE);
+			chunk_remaining = PGDUCKDB_PARALLEL_SCAN_CHUNK_SIZE;
+		}
+		if (position >= shared->m_nblocks) {
+			break;
+		}
+		BlockNumber block = shared->m_start_block + (BlockNumber)position;
+		position++;
+		chunk_remaining--;
+
+		CHECK_FOR_INTERRUPTS();
+		Buffer buffer = ReadBufferExtended(rel, MAIN_FORKNUM, block, RBM_NORMAL, strategy);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		Page page = BufferGetPage(buffer);
+#if PG_VERSION_NUM < 170000
+		TestForOldSnapshot(snapshot, rel, page);
+#endif
+		bool all_visible = PageIsAllVisible(page) && !snapshot->takenDuringRecovery;
+		OffsetNumber max_offset = PageGetMaxOffsetNumber(page);
+		int ntuples = 0;
+		for (OffsetNumber offset = FirstOffsetNumber; offset <= max_offset; offset++) {
+			ItemId item_id = PageGetItemId(page, offset);
+			if (!ItemIdIsNormal(item_id)) {
+				continue;
+			}
+			HeapTupleData tuple;
+			tuple.t_data = (HeapTupleHeader)PageGetItem(page, item_id);
+			tuple.t_len = ItemIdGetLength(item_id);
+			tuple.t_tableOid = shared->m_relid;
+			ItemPointerSet(&tuple.t_self, block, offset);
+			if (all_visible || HeapTupleSatisfiesVisibility(&tuple, snapshot, buffer)) {
+				page_tuples[ntuples++] = offset;
+			}
+		}
+		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+
+		for (int i = 0; i < ntuples && !detached; i++) {
+			ItemId item_id = PageGetItemId(page, page_tuples[i]);
+			ItemPointerData tid;
+			ItemPointerSet(&tid, block, page_tuples[i]);
+			memcpy(header, &tid, sizeof(ItemPointerData));
+
+			shm_mq_iovec iov[2];
+			iov[0].data = header;
+			iov[0].len = PGDUCKDB_PARALLEL_SCAN_TID_SIZE;
+			iov[1].data = (const char *)PageGetItem(page, item_id);
+			iov[1].len = ItemIdGetLength(item_id);
+			int iovcnt = shared->m_count_tuples_only ? 1 : 2;
+			detached = shm_mq_sendv(mqh, iov, iovcnt, false, false) == SHM_MQ_DETACHED;
+		}
+		ReleaseBuffer(buffer);
+	}
+
+	shm_mq_detach(mqh);
+	FreeAccessStrategy(strategy);
+	table_close(rel, AccessShareLock);
+}
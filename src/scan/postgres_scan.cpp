@@ -11,19 +11,27 @@
 #include "duckdb/parser/qualified_name.hpp"
 #include "duckdb/common/enums/statement_type.hpp"
 #include "duckdb/common/enums/expression_type.hpp"
+#include "duckdb/common/types/hash.hpp"
+#include "duckdb/common/printer.hpp"
+#include "duckdb/common/string_util.hpp"
 
 extern "C" {
 #include "postgres.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_class.h"
+#include "catalog/pg_statistic.h"
 #include "optimizer/planmain.h"
 #include "optimizer/planner.h"
+#include "storage/bufmgr.h"
+#include "access/htup_details.h"
 #include "utils/builtins.h"
 #include "utils/regproc.h"
+#include "utils/rel.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 }
 
+#include "pgduckdb/pgduckdb.h"
 #include "pgduckdb/pgduckdb_process_lock.hpp"
 #include "pgduckdb/scan/postgres_scan.hpp"
 #include "pgduckdb/pgduckdb_types.hpp"
@@ -33,9 +41,13 @@ namespace pgduckdb {
 
 void
 PostgresScanGlobalState::InitGlobalState(duckdb::TableFunctionInitInput &input) {
-	/* SELECT COUNT(*) FROM */
-	if (input.column_ids.size() == 1 && input.column_ids[0] == UINT64_MAX) {
+	/*
+	 * SELECT COUNT(*) FROM, DuckDB then only asks for the rowid. A scan of
+	 * just the rowid looks the same, so the rowid is still filled in.
+	 */
+	if (input.column_ids.size() == 1 && input.column_ids[0] == duckdb::COLUMN_IDENTIFIER_ROW_ID) {
 		m_count_tuples_only = true;
+		m_emit_rowid = true;
 		return;
 	}
 
@@ -76,6 +88,286 @@ PostgresScanGlobalState::InitRelationMissingAttrs(TupleDesc tuple_desc) {
 	}
 }
 
+/*
+ * Compile the deform plan of the read columns into flat arrays, so the per
+ * tuple work does not need to look at the TupleDesc, the read columns map or
+ * the missing attributes map. Must run after InitRelationMissingAttrs.
+ */
+void
+PostgresScanGlobalState::InitDeformPlan(TupleDesc tuple_desc) {
+	int natts = 0;
+	for (auto const &[column_idx, value_idx] : m_read_columns_ids) {
+		if (column_idx != duckdb::COLUMN_IDENTIFIER_ROW_ID) {
+			natts = (int)column_idx + 1;
+		}
+	}
+	bool in_fixed_prefix = true;
+	int offset = 0;
+
+	m_deform_attrs.resize(natts);
+	for (int attnum = 0; attnum < natts; attnum++) {
+		Form_pg_attribute attr = TupleDescAttr(tuple_desc, attnum);
+		auto &deform_attr = m_deform_attrs[attnum];
+
+		deform_attr.attlen = attr->attlen;
+		deform_attr.attbyval = attr->attbyval;
+		deform_attr.attalign = attr->attalign;
+		deform_attr.fixed_offset = -1;
+		deform_attr.value_idx = -1;
+
+		/* Same computation as the attcacheoff caching in heap deforming */
+		if (in_fixed_prefix && attr->attlen > 0) {
+			offset = att_align_nominal(offset, attr->attalign);
+			deform_attr.fixed_offset = offset;
+			offset += attr->attlen;
+			m_deform_fixed_natts = attnum + 1;
+			m_deform_fixed_len = offset;
+		} else {
+			in_fixed_prefix = false;
+		}
+	}
+
+	duckdb::map<duckdb::idx_t, int> read_column_index;
+	m_deform_shape = PostgresScanDeformShape::ALL_FIXED;
+	for (auto const &[column_idx, value_idx] : m_read_columns_ids) {
+		/* The rowid is not stored in the tuple, it is made from its ctid */
+		if (column_idx == duckdb::COLUMN_IDENTIFIER_ROW_ID) {
+			continue;
+		}
+		auto &deform_attr = m_deform_attrs[column_idx];
+		PostgresScanReadColumn read_column = {};
+
+		deform_attr.value_idx = value_idx;
+		read_column.attnum = column_idx;
+		read_column.value_idx = value_idx;
+		read_column.atttypid = TupleDescAttr(tuple_desc, column_idx)->atttypid;
+		if (m_filters && m_filters->filters.find(value_idx) != m_filters->filters.end()) {
+			read_column.filter = m_filters->filters[value_idx].get();
+			m_column_filters.emplace_back(*read_column.filter, read_column.atttypid, value_idx);
+		}
+		read_column.read_in_place = deform_attr.fixed_offset >= 0 && deform_attr.attbyval && !read_column.filter;
+		auto missing_attr = m_relation_missing_attrs.find(column_idx);
+		if (missing_attr != m_relation_missing_attrs.end()) {
+			read_column.has_missing_value = true;
+			read_column.missing_value = missing_attr->second;
+		}
+		if (deform_attr.fixed_offset < 0) {
+			m_deform_shape = PostgresScanDeformShape::FIXED_PREFIX_VARLENA;
+		}
+
+		read_column_index[column_idx] = m_deform_read_columns.size();
+		m_deform_read_columns.push_back(read_column);
+	}
+
+	for (auto const &[output_idx, column_idx] : m_output_columns_ids) {
+		if (column_idx == duckdb::COLUMN_IDENTIFIER_ROW_ID) {
+			m_output_read_columns.push_back(-1);
+			m_emit_rowid = true;
+			continue;
+		}
+		m_output_read_columns.push_back(read_column_index[column_idx]);
+		if (m_deform_attrs[column_idx].attlen == -1) {
+			m_zero_copy_strings = duckdb_postgres_scan_zero_copy_strings;
+		}
+	}
+}
+
+/*
+ * Estimated ratio of distinct values to rows of a column from its statistics,
+ * 0 when it has so few distinct values that any chunk fits the dictionary and
+ * -1 without statistics.
+ */
+static double
+EstimateDistinctRatio(Relation rel, AttrNumber attnum) {
+	HeapTuple tuple = SearchSysCache3(STATRELATTINH, ObjectIdGetDatum(RelationGetRelid(rel)), Int16GetDatum(attnum),
+	                                  BoolGetDatum(false));
+	if (!HeapTupleIsValid(tuple)) {
+		return -1;
+	}
+	double stadistinct = ((Form_pg_statistic)GETSTRUCT(tuple))->stadistinct;
+	ReleaseSysCache(tuple);
+
+	/* Negative values are the ratio itself, positive ones a number of distinct values */
+	if (stadistinct < 0) {
+		return -stadistinct;
+	}
+	if (stadistinct == 0) {
+		return -1;
+	}
+	if (stadistinct <= PostgresScanStringDictionary::MAX_SIZE) {
+		return 0;
+	}
+	return rel->rd_rel->reltuples > 0 ? stadistinct / rel->rd_rel->reltuples : -1;
+}
+
+/*
+ * Decide which read text columns are dictionary encoded. Zero-copy strings
+ * win over dictionaries: a dictionary copies every distinct value, so with
+ * duckdb.postgres_scan_zero_copy_strings no column is encoded. Otherwise a
+ * column is encoded unless its statistics show more distinct values per row
+ * than a chunk of STANDARD_VECTOR_SIZE rows can hold in the dictionary.
+ * Columns without statistics are tried, the dictionary gives up per chunk.
+ */
+void
+PostgresScanGlobalState::InitDictionaryColumns(Relation rel) {
+	m_dictionary_columns.assign(m_tuple_desc->natts, false);
+	if (m_zero_copy_strings) {
+		return;
+	}
+	const double max_ratio = (double)PostgresScanStringDictionary::MAX_SIZE / STANDARD_VECTOR_SIZE;
+	std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+	for (const auto &read_column : m_deform_read_columns) {
+		if (m_deform_attrs[read_column.attnum].attlen != -1) {
+			continue;
+		}
+		double ratio =
+		    PostgresFunctionGuard<double>(EstimateDistinctRatio, rel, (AttrNumber)(read_column.attnum + 1));
+		m_dictionary_columns[read_column.attnum] = ratio <= max_ratio;
+	}
+}
+
+/*
+ * Maximum number of pages an output chunk keeps pinned for its strings. When
+ * a chunk spans more pages, for example behind a selective filter, the strings
+ * of the remaining pages are copied.
+ */
+#define MAX_CHUNK_PAGE_PINS 32
+
+/*
+ * Runs on whichever thread drops the last vector referencing the pages. An
+ * error must not escape the destructor, it is printed and the remaining pins
+ * are still released.
+ */
+PostgresScanPagePins::~PostgresScanPagePins() {
+	if (m_buffers.empty()) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+	for (auto buffer : m_buffers) {
+		try {
+			PostgresFunctionGuard(ReleaseBuffer, buffer);
+		} catch (std::exception &ex) {
+			duckdb::Printer::Print(duckdb::StringUtil::Format(
+			    "(PGDuckDB/PostgresScanPagePins) Could not release buffer %d: %s", buffer, ex.what()));
+		}
+	}
+}
+
+/*
+ * Take an extra pin on a buffer the caller has pinned. Returns false when the
+ * holder is full. DuckdbProcessLock must be held.
+ */
+bool
+PostgresScanPagePins::Pin(Buffer buffer) {
+	if (!m_buffers.empty() && m_buffers.back() == buffer) {
+		return true;
+	}
+	if (m_buffers.size() >= MAX_CHUNK_PAGE_PINS) {
+		return false;
+	}
+	PostgresFunctionGuard(IncrBufferRefCount, buffer);
+	m_buffers.push_back(buffer);
+	return true;
+}
+
+/*
+ * Pin the page of the current batch for the output chunk being filled and
+ * return the pin holder to attach to its string vectors, or nullptr when the
+ * strings of the batch have to be copied.
+ */
+duckdb::buffer_ptr<duckdb::VectorBuffer>
+PostgresScanLocalState::PinBatchPage() {
+	if (!BufferIsValid(m_batch_buffer)) {
+		return nullptr;
+	}
+	if (m_output_vector_size == 0 || !m_page_pins) {
+		m_page_pins = duckdb::make_buffer<PostgresScanPagePins>();
+	}
+	std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+	if (!m_page_pins->Pin(m_batch_buffer)) {
+		return nullptr;
+	}
+	return m_page_pins;
+}
+
+/*
+ * Start a dictionary for the next chunk. The vector and selection of the
+ * previous chunk may still be referenced by DuckDB, so they are replaced
+ * rather than reused.
+ */
+void
+PostgresScanStringDictionary::Reset() {
+	m_active = true;
+	m_dictionary = duckdb::make_uniq<duckdb::Vector>(m_type, MAX_SIZE);
+	m_sel.Initialize(STANDARD_VECTOR_SIZE);
+	m_size = 0;
+	m_null_index = -1;
+	memset(m_table, 0, sizeof(m_table));
+}
+
+/*
+ * Make row refer to the dictionary entry of a value, adding the value when it
+ * is new. Returns false when the dictionary is full.
+ */
+bool
+PostgresScanStringDictionary::AddValue(const char *data, idx_t len, idx_t row) {
+	auto hash = duckdb::Hash(data, len);
+	auto entries = duckdb::FlatVector::GetData<duckdb::string_t>(*m_dictionary);
+	idx_t slot = hash & (HASH_TABLE_SIZE - 1);
+
+	while (m_table[slot]) {
+		idx_t entry = m_table[slot] - 1;
+		if (m_hashes[entry] == hash && entries[entry].GetSize() == len &&
+		    memcmp(entries[entry].GetData(), data, len) == 0) {
+			m_sel.set_index(row, entry);
+			return true;
+		}
+		slot = (slot + 1) & (HASH_TABLE_SIZE - 1);
+	}
+
+	if (m_size == MAX_SIZE) {
+		return false;
+	}
+	entries[m_size] = duckdb::StringVector::AddString(*m_dictionary, data, len);
+	m_hashes[m_size] = hash;
+	m_table[slot] = m_size + 1;
+	m_sel.set_index(row, m_size++);
+	return true;
+}
+
+bool
+PostgresScanStringDictionary::AddNull(idx_t row) {
+	if (m_null_index < 0) {
+		if (m_size == MAX_SIZE) {
+			return false;
+		}
+		m_null_index = m_size++;
+		duckdb::FlatVector::SetNull(*m_dictionary, m_null_index, true);
+	}
+	m_sel.set_index(row, m_null_index);
+	return true;
+}
+
+/*
+ * Write the first count rows of the chunk into result as plain strings and
+ * stop using the dictionary for the rest of the chunk. The strings stay in
+ * the dictionary string heap, which result keeps a reference to.
+ */
+void
+PostgresScanStringDictionary::Flatten(duckdb::Vector &result, idx_t count) {
+	auto data = duckdb::FlatVector::GetData<duckdb::string_t>(result);
+	auto entries = duckdb::FlatVector::GetData<duckdb::string_t>(*m_dictionary);
+	auto &validity = duckdb::FlatVector::Validity(result);
+
+	for (idx_t row = 0; row < count; row++) {
+		if (validity.RowIsValid(row)) {
+			data[row] = entries[m_sel.get_index(row)];
+		}
+	}
+	duckdb::StringVector::AddHeapReference(result, *m_dictionary);
+	m_active = false;
+}
+
 static Oid
 FindMatchingRelation(const duckdb::string &schema, const duckdb::string &table) {
 	List *name_list = NIL;
@@ -0,0 +1,276 @@
+#include "duckdb.hpp"
+#include "duckdb/common/random_engine.hpp"
+#include "duckdb/planner/expression/bound_aggregate_expression.hpp"
+#include "duckdb/planner/expression/bound_columnref_expression.hpp"
+#include "duckdb/planner/expression/bound_comparison_expression.hpp"
+#include "duckdb/planner/expression/bound_constant_expression.hpp"
+#include "duckdb/planner/operator/logical_aggregate.hpp"
+#include "duckdb/planner/operator/logical_filter.hpp"
+#include "duckdb/planner/operator/logical_get.hpp"
+#include "duckdb/planner/operator/logical_projection.hpp"
+#include "duckdb/planner/operator/logical_sample.hpp"
+#include "duckdb/planner/operator/logical_top_n.hpp"
+
+#include "pgduckdb/scan/postgres_scan_optimizer.hpp"
+#include "pgduckdb/scan/postgres_seq_scan.hpp"
+
+namespace pgduckdb {
+
+/* Largest number of rows of a top-N that are read through an ordered index scan */
+#define PGDUCKDB_ORDERED_SCAN_MAX_ROWS 10000
+
+/*
+ * The postgres_seq_scan the column reference reads from, as seen from the
+ * output of the operator, and the DuckDB column id of the column. Only
+ * projections are looked through, other operators may drop or add rows so
+ * the rows of the scan are no longer the rows the operator sees.
+ */
+static duckdb::LogicalGet *
+FindScanColumn(duckdb::LogicalOperator &op, const duckdb::Expression &expr, duckdb::column_t *column_id) {
+	if (expr.type != duckdb::ExpressionType::BOUND_COLUMN_REF) {
+		return nullptr;
+	}
+	auto binding = expr.Cast<duckdb::BoundColumnRefExpression>().binding;
+	auto child = &op;
+	while (child->type == duckdb::LogicalOperatorType::LOGICAL_PROJECTION) {
+		auto &projection = child->Cast<duckdb::LogicalProjection>();
+		if (binding.table_index != projection.table_index || binding.column_index >= projection.expressions.size()) {
+			return nullptr;
+		}
+		auto &projected = *projection.expressions[binding.column_index];
+		if (projected.type != duckdb::ExpressionType::BOUND_COLUMN_REF) {
+			return nullptr;
+		}
+		binding = projected.Cast<duckdb::BoundColumnRefExpression>().binding;
+		child = child->children[0].get();
+	}
+
+	if (child->type != duckdb::LogicalOperatorType::LOGICAL_GET) {
+		return nullptr;
+	}
+	auto &get = child->Cast<duckdb::LogicalGet>();
+	if (get.table_index != binding.table_index || get.function.name != "postgres_seq_scan" || !get.bind_data ||
+	    binding.column_index >= get.column_ids.size()) {
+		return nullptr;
+	}
+	*column_id = get.column_ids[binding.column_index];
+	return &get;
+}
+
+/* Same as FindScanColumn, for a column of the table, with its attribute number starting at 0 */
+static duckdb::LogicalGet *
+FindScanAttribute(duckdb::LogicalOperator &op, const duckdb::Expression &expr, int *attnum) {
+	duckdb::column_t column_id;
+	auto get = FindScanColumn(op, expr, &column_id);
+	if (!get || column_id == duckdb::COLUMN_IDENTIFIER_ROW_ID) {
+		return nullptr;
+	}
+	*attnum = (int)column_id;
+	return get;
+}
+
+static void
+SetScanOrder(duckdb::LogicalGet &get, int attnum, bool desc, bool nulls_first, bool skip_nulls, duckdb::idx_t limit) {
+	auto &bind_data = get.bind_data->Cast<PostgresSeqScanFunctionData>();
+	bind_data.m_order =
+	    duckdb::make_uniq<PostgresScanOrder>(PostgresScanOrder {attnum, desc, nulls_first, skip_nulls, limit});
+}
+
+/* ORDER BY column LIMIT n [OFFSET m] needs the first n + m rows */
+static void
+PushDownTopN(duckdb::LogicalTopN &top_n) {
+	if (top_n.orders.size() != 1 || top_n.limit > PGDUCKDB_ORDERED_SCAN_MAX_ROWS ||
+	    top_n.offset > PGDUCKDB_ORDERED_SCAN_MAX_ROWS - top_n.limit || top_n.limit + top_n.offset == 0) {
+		return;
+	}
+	auto &order = top_n.orders[0];
+	if (order.type == duckdb::OrderType::ORDER_DEFAULT || order.null_order == duckdb::OrderByNullType::ORDER_DEFAULT) {
+		return;
+	}
+	int attnum;
+	auto get = FindScanAttribute(*top_n.children[0], *order.expression, &attnum);
+	if (get) {
+		SetScanOrder(*get, attnum, order.type == duckdb::OrderType::DESCENDING,
+		             order.null_order == duckdb::OrderByNullType::NULLS_FIRST, false, top_n.limit + top_n.offset);
+	}
+}
+
+/* MIN or MAX of a column over the whole scan needs its first non-NULL row */
+static void
+PushDownMinMax(duckdb::LogicalAggregate &aggregate) {
+	if (!aggregate.groups.empty() || aggregate.expressions.size() != 1 ||
+	    aggregate.expressions[0]->GetExpressionClass() != duckdb::ExpressionClass::BOUND_AGGREGATE) {
+		return;
+	}
+	auto &expr = aggregate.expressions[0]->Cast<duckdb::BoundAggregateExpression>();
+	const auto &name = expr.function.name;
+	if ((name != "min" && name != "max") || expr.children.size() != 1 || expr.filter || expr.order_bys) {
+		return;
+	}
+	int attnum;
+	auto get = FindScanAttribute(*aggregate.children[0], *expr.children[0], &attnum);
+	if (get) {
+		SetScanOrder(*get, attnum, name == "max", false, true, 1);
+	}
+}
+
+/*
+ * Narrow the inclusive rowid range [min_rowid, max_rowid] by a comparison of
+ * the rowid of the scan with a constant. Returns the scan or nullptr when the
+ * expression is no such comparison.
+ */
+static duckdb::LogicalGet *
+NarrowRowIdRange(duckdb::LogicalOperator &op, const duckdb::Expression &expr, int64_t &min_rowid,
+                 int64_t &max_rowid) {
+	if (expr.GetExpressionClass() != duckdb::ExpressionClass::BOUND_COMPARISON) {
+		return nullptr;
+	}
+	auto &comparison = expr.Cast<duckdb::BoundComparisonExpression>();
+	auto type = comparison.type;
+	auto column = comparison.left.get();
+	auto constant = comparison.right.get();
+	if (constant->type != duckdb::ExpressionType::VALUE_CONSTANT) {
+		std::swap(column, constant);
+		type = duckdb::FlipComparisonExpression(type);
+	}
+	duckdb::column_t column_id;
+	if (constant->type != duckdb::ExpressionType::VALUE_CONSTANT) {
+		return nullptr;
+	}
+	auto get = FindScanColumn(op, *column, &column_id);
+	auto &value = constant->Cast<duckdb::BoundConstantExpression>().value;
+	if (!get || column_id != duckdb::COLUMN_IDENTIFIER_ROW_ID || value.IsNull() ||
+	    value.type().id() != duckdb::LogicalTypeId::BIGINT) {
+		return nullptr;
+	}
+
+	int64_t rowid = value.GetValue<int64_t>();
+	switch (type) {
+	case duckdb::ExpressionType::COMPARE_EQUAL:
+		min_rowid = std::max(min_rowid, rowid);
+		max_rowid = std::min(max_rowid, rowid);
+		break;
+	case duckdb::ExpressionType::COMPARE_GREATERTHAN:
+		if (rowid == duckdb::NumericLimits<int64_t>::Maximum()) {
+			max_rowid = -1;
+		} else {
+			min_rowid = std::max(min_rowid, rowid + 1);
+		}
+		break;
+	case duckdb::ExpressionType::COMPARE_GREATERTHANOREQUALTO:
+		min_rowid = std::max(min_rowid, rowid);
+		break;
+	case duckdb::ExpressionType::COMPARE_LESSTHAN:
+		max_rowid = rowid <= 0 ? -1 : std::min(max_rowid, rowid - 1);
+		break;
+	case duckdb::ExpressionType::COMPARE_LESSTHANOREQUALTO:
+		max_rowid = std::min(max_rowid, rowid);
+		break;
+	default:
+		return nullptr;
+	}
+	return get;
+}
+
+/*
+ * DuckDB keeps filters on the rowid in a filter above the scan instead of
+ * pushing them into it. The rowid holds the ctid of the row, so comparisons
+ * with constants bound the blocks the scan has to read, as a TID range scan
+ * does. The filter itself stays in place and drops the other rows.
+ */
+static void
+PushDownRowIdRange(duckdb::LogicalFilter &filter) {
+	duckdb::LogicalGet *get = nullptr;
+	int64_t min_rowid = 0;
+	int64_t max_rowid = duckdb::NumericLimits<int64_t>::Maximum();
+	for (auto &expr : filter.expressions) {
+		auto comparison_get = NarrowRowIdRange(*filter.children[0], *expr, min_rowid, max_rowid);
+		if (comparison_get) {
+			get = comparison_get;
+		}
+	}
+	if (!get) {
+		return;
+	}
+
+	/* The ctids of different partitions overlap */
+	auto &bind_data = get->bind_data->Cast<PostgresSeqScanFunctionData>();
+	if (!bind_data.m_partitions.empty()) {
+		return;
+	}
+	if (max_rowid < min_rowid) {
+		bind_data.m_end_block = 0;
+		return;
+	}
+	bind_data.m_start_block = (BlockNumber)std::min<int64_t>(min_rowid >> 16, InvalidBlockNumber);
+	bind_data.m_end_block = (BlockNumber)std::min<int64_t>((max_rowid >> 16) + 1, InvalidBlockNumber);
+}
+
+/*
+ * A SYSTEM or BERNOULLI percentage sample directly on a postgres_seq_scan is
+ * drawn by its heap readers, so skipped blocks are never read. Returns
+ * whether the scan took the sample over and the sample operator can go.
+ */
+static bool
+PushDownSample(duckdb::LogicalSample &sample) {
+	auto &options = *sample.sample_options;
+	auto &child = *sample.children[0];
+	if (child.type != duckdb::LogicalOperatorType::LOGICAL_GET ||
+	    child.Cast<duckdb::LogicalGet>().function.name != "postgres_seq_scan" || !options.is_percentage ||
+	    (options.method != duckdb::SampleMethod::SYSTEM_SAMPLE &&
+	     options.method != duckdb::SampleMethod::BERNOULLI_SAMPLE)) {
+		return false;
+	}
+
+	HeapReaderSample scan_sample;
+	scan_sample.m_method =
+	    options.method == duckdb::SampleMethod::SYSTEM_SAMPLE ? HeapReaderSample::SYSTEM : HeapReaderSample::BERNOULLI;
+	scan_sample.m_percentage = options.sample_size.GetValue<double>();
+	scan_sample.m_seed = options.seed >= 0 ? (uint32_t)options.seed : duckdb::RandomEngine().NextRandomInteger();
+	auto &bind_data = child.Cast<duckdb::LogicalGet>().bind_data->Cast<PostgresSeqScanFunctionData>();
+	bind_data.m_sample = duckdb::make_uniq<HeapReaderSample>(scan_sample);
+	return true;
+}
+
+static void
+PushDownScanHints(duckdb::unique_ptr<duckdb::LogicalOperator> &op_ptr) {
+	if (op_ptr->type == duckdb::LogicalOperatorType::LOGICAL_SAMPLE &&
+	    PushDownSample(op_ptr->Cast<duckdb::LogicalSample>())) {
+		auto child = std::move(op_ptr->children[0]);
+		op_ptr = std::move(child);
+	}
+
+	auto &op = *op_ptr;
+	switch (op.type) {
+	case duckdb::LogicalOperatorType::LOGICAL_FILTER:
+		PushDownRowIdRange(op.Cast<duckdb::LogicalFilter>());
+		break;
+	case duckdb::LogicalOperatorType::LOGICAL_TOP_N:
+		PushDownTopN(op.Cast<duckdb::LogicalTopN>());
+		break;
+	case duckdb::LogicalOperatorType::LOGICAL_AGGREGATE_AND_GROUP_BY:
+		PushDownMinMax(op.Cast<duckdb::LogicalAggregate>());
+		break;
+	default:
+		break;
+	}
+	for (auto &child : op.children) {
+		PushDownScanHints(child);
+	}
+}
+
+//
+// PostgresScanOptimizer
+//
+
+PostgresScanOptimizer::PostgresScanOptimizer() {
+	optimize_function = Optimize;
+}
+
+void
+PostgresScanOptimizer::Optimize(duckdb::OptimizerExtensionInput &input,
+                                duckdb::unique_ptr<duckdb::LogicalOperator> &plan) {
+	PushDownScanHints(plan);
+}
+
+} // namespace pgduckdb
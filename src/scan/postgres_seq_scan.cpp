@@ -1,7 +1,14 @@
 #include "duckdb.hpp"
 
+extern "C" {
+#include "postgres.h"
+#include "catalog/pg_class.h"
+}
+
 #include "pgduckdb/scan/postgres_seq_scan.hpp"
+#include "pgduckdb/scan/postgres_index_pruning.hpp"
 #include "pgduckdb/pgduckdb_types.hpp"
+#include <algorithm>
 #include <inttypes.h>
 
 namespace pgduckdb {
@@ -10,18 +17,42 @@ namespace pgduckdb {
 // PostgresSeqScanGlobalState
 //
 
-PostgresSeqScanGlobalState::PostgresSeqScanGlobalState(Relation rel, duckdb::TableFunctionInitInput &input)
-    : m_global_state(duckdb::make_shared_ptr<PostgresScanGlobalState>()),
-      m_heap_reader_global_state(duckdb::make_shared_ptr<HeapReaderGlobalState>(rel)), m_rel(rel) {
-	m_global_state->InitGlobalState(input);
-	m_global_state->m_tuple_desc = RelationGetDescr(m_rel);
-	m_global_state->InitRelationMissingAttrs(m_global_state->m_tuple_desc);
+PostgresSeqScanGlobalState::PostgresSeqScanGlobalState(
+    Relation rel, duckdb::shared_ptr<PostgresScanGlobalState> global_state,
+    duckdb::shared_ptr<HeapReaderGlobalState> heap_reader_global_state)
+    : m_global_state(global_state), m_heap_reader_global_state(heap_reader_global_state), m_rel(rel), m_partition(0) {
 	elog(DEBUG2, "(DuckDB/PostgresSeqScanGlobalState) Running %" PRIu64 " threads -- ", (uint64_t)MaxThreads());
 }
 
 PostgresSeqScanGlobalState::~PostgresSeqScanGlobalState() {
 }
 
+/*
+ * Move the reader of a thread that found no more blocks in its partition on
+ * to the next partition, or to the one the other readers already moved on
+ * to. Returns false once all partitions are done.
+ */
+bool
+PostgresSeqScanGlobalState::NextPartition(PostgresSeqScanLocalState &local_state) {
+	if (m_partitions.empty()) {
+		return false;
+	}
+	idx_t next = local_state.m_partition + 1;
+	idx_t current = m_partition.load();
+	while (current < next && !m_partition.compare_exchange_weak(current, next)) {
+	}
+	next = std::max(current, next);
+	if (next >= m_partitions.size()) {
+		return false;
+	}
+
+	auto &partition = m_partitions[next];
+	local_state.m_partition = next;
+	local_state.m_heap_table_reader = duckdb::make_uniq<HeapReader>(
+	    partition.m_rel, partition.m_heap_reader_global_state, partition.m_global_state, local_state.m_local_state);
+	return true;
+}
+
 //
 // PostgresSeqScanLocalState
 //
@@ -41,7 +72,8 @@ PostgresSeqScanLocalState::~PostgresSeqScanLocalState() {
 //
 
 PostgresSeqScanFunctionData::PostgresSeqScanFunctionData(::Relation rel, uint64_t cardinality, Snapshot snapshot)
-    : m_rel(rel), m_cardinality(cardinality), m_snapshot(snapshot) {
+    : m_rel(rel), m_cardinality(cardinality), m_snapshot(snapshot), m_start_block(0),
+      m_end_block(InvalidBlockNumber) {
 }
 
 PostgresSeqScanFunctionData::~PostgresSeqScanFunctionData() {
@@ -51,6 +83,66 @@ PostgresSeqScanFunctionData::~PostgresSeqScanFunctionData() {
 // PostgresSeqScanFunction
 //
 
+/* Read columns, filters and deform plan of the scan of one relation */
+static duckdb::shared_ptr<PostgresScanGlobalState>
+CreateScanGlobalState(Relation rel, duckdb::TableFunctionInitInput &input, Snapshot snapshot) {
+	auto global_state = duckdb::make_shared_ptr<PostgresScanGlobalState>();
+	global_state->InitGlobalState(input);
+	global_state->m_tuple_desc = RelationGetDescr(rel);
+	global_state->InitRelationMissingAttrs(global_state->m_tuple_desc);
+	global_state->InitDeformPlan(global_state->m_tuple_desc);
+	global_state->InitDictionaryColumns(rel);
+	global_state->m_snapshot = snapshot;
+	return global_state;
+}
+
+/* Restrict the blocks the heap readers of the relation read, set up sampling and zone maps */
+static void
+PrepareHeapScan(const PostgresSeqScanFunctionData &bind_data, Relation rel, const PostgresScanGlobalState &global_state,
+                HeapReaderGlobalState &heap_reader_global_state) {
+	if (bind_data.m_sample) {
+		heap_reader_global_state.SetSample(*bind_data.m_sample);
+	}
+	if (bind_data.m_start_block != 0 || bind_data.m_end_block != InvalidBlockNumber) {
+		heap_reader_global_state.RestrictToBlockRange(bind_data.m_start_block, bind_data.m_end_block);
+	}
+	duckdb::vector<BlockNumber> blocks;
+	if (PostgresScanBitmapBlocks(rel, bind_data.m_snapshot, global_state, blocks)) {
+		heap_reader_global_state.RestrictToBlocks(std::move(blocks));
+	}
+	heap_reader_global_state.m_zone_map = PostgresScanZoneMap::Create(rel, global_state);
+}
+
+/*
+ * Scan the leaf partitions whose partition constraint the filters do not
+ * contradict. When all are pruned the partitioned table itself is scanned,
+ * it has no blocks.
+ */
+static duckdb::unique_ptr<duckdb::GlobalTableFunctionState>
+InitPartitionedGlobal(const PostgresSeqScanFunctionData &bind_data, duckdb::TableFunctionInitInput &input) {
+	duckdb::vector<PostgresSeqScanPartition> partitions;
+	for (auto partition_rel : bind_data.m_partitions) {
+		auto global_state = CreateScanGlobalState(partition_rel, input, bind_data.m_snapshot);
+		if (PostgresScanPartitionExcluded(partition_rel, *global_state)) {
+			continue;
+		}
+		auto heap_reader_global_state = duckdb::make_shared_ptr<HeapReaderGlobalState>(partition_rel);
+		PrepareHeapScan(bind_data, partition_rel, *global_state, *heap_reader_global_state);
+		heap_reader_global_state->SynchronizeScan(partition_rel);
+		partitions.push_back({partition_rel, global_state, heap_reader_global_state});
+	}
+
+	if (partitions.empty()) {
+		return duckdb::make_uniq<PostgresSeqScanGlobalState>(
+		    bind_data.m_rel, CreateScanGlobalState(bind_data.m_rel, input, bind_data.m_snapshot),
+		    duckdb::make_shared_ptr<HeapReaderGlobalState>(bind_data.m_rel));
+	}
+	auto global_state = duckdb::make_uniq<PostgresSeqScanGlobalState>(
+	    partitions[0].m_rel, partitions[0].m_global_state, partitions[0].m_heap_reader_global_state);
+	global_state->m_partitions = std::move(partitions);
+	return std::move(global_state);
+}
+
 PostgresSeqScanFunction::PostgresSeqScanFunction()
     : TableFunction("postgres_seq_scan", {}, PostgresSeqScanFunc, nullptr, PostgresSeqScanInitGlobal,
                     PostgresSeqScanInitLocal) {
@@ -67,8 +159,35 @@ duckdb::unique_ptr<duckdb::GlobalTableFunctionState>
 PostgresSeqScanFunction::PostgresSeqScanInitGlobal(duckdb::ClientContext &context,
                                                    duckdb::TableFunctionInitInput &input) {
 	auto &bind_data = input.bind_data->CastNoConst<PostgresSeqScanFunctionData>();
-	auto global_state = duckdb::make_uniq<PostgresSeqScanGlobalState>(bind_data.m_rel, input);
-	global_state->m_global_state->m_snapshot = bind_data.m_snapshot;
+	if (bind_data.m_rel->rd_rel->relkind == RELKIND_PARTITIONED_TABLE) {
+		return InitPartitionedGlobal(bind_data, input);
+	}
+
+	auto global_state = duckdb::make_uniq<PostgresSeqScanGlobalState>(
+	    bind_data.m_rel, CreateScanGlobalState(bind_data.m_rel, input, bind_data.m_snapshot),
+	    duckdb::make_shared_ptr<HeapReaderGlobalState>(bind_data.m_rel));
+	/* A sample is only drawn by the heap readers */
+	if (!bind_data.m_sample) {
+		global_state->m_index_scan = PostgresIndexScan::Create(bind_data.m_rel, bind_data.m_snapshot,
+		                                                       global_state->m_global_state, bind_data.m_order.get());
+	}
+	if (global_state->m_index_scan) {
+		return std::move(global_state);
+	}
+	PrepareHeapScan(bind_data, bind_data.m_rel, *global_state->m_global_state,
+	                *global_state->m_heap_reader_global_state);
+	BlockNumber start_block, end_block;
+	duckdb::Value parallel_safe;
+	if (!bind_data.m_sample && global_state->m_heap_reader_global_state->GetBlockRange(start_block, end_block) &&
+	    context.TryGetCurrentSetting(PGDUCKDB_PARALLEL_SCAN_SAFE_SETTING, parallel_safe)) {
+		global_state->m_parallel_scan =
+		    PostgresParallelScan::Create(bind_data.m_rel, bind_data.m_snapshot, global_state->m_global_state,
+		                                 start_block, end_block, parallel_safe.GetValue<bool>());
+	}
+	/* Only the heap readers join synchronized scans, the parallel workers read the blocks in order */
+	if (!global_state->m_parallel_scan) {
+		global_state->m_heap_reader_global_state->SynchronizeScan(bind_data.m_rel);
+	}
 	return std::move(global_state);
 }
 
@@ -77,14 +196,22 @@ PostgresSeqScanFunction::PostgresSeqScanInitLocal(duckdb::ExecutionContext &cont
                                                   duckdb::TableFunctionInitInput &input,
                                                   duckdb::GlobalTableFunctionState *gstate) {
 	auto global_state = reinterpret_cast<PostgresSeqScanGlobalState *>(gstate);
-	return duckdb::make_uniq<PostgresSeqScanLocalState>(
+	auto local_state = duckdb::make_uniq<PostgresSeqScanLocalState>(
 	    global_state->m_rel, global_state->m_heap_reader_global_state, global_state->m_global_state);
+	/* Readers that start late join the partition the others are reading */
+	idx_t partition = global_state->m_partition.load();
+	if (partition > 0) {
+		local_state->m_partition = partition - 1;
+		global_state->NextPartition(*local_state);
+	}
+	return std::move(local_state);
 }
 
 void
 PostgresSeqScanFunction::PostgresSeqScanFunc(duckdb::ClientContext &context, duckdb::TableFunctionInput &data,
                                              duckdb::DataChunk &output) {
 	auto &local_state = data.local_state->Cast<PostgresSeqScanLocalState>();
+	auto &global_state = data.global_state->Cast<PostgresSeqScanGlobalState>();
 
 	local_state.m_local_state->m_output_vector_size = 0;
 
@@ -94,10 +221,37 @@ PostgresSeqScanFunction::PostgresSeqScanFunc(duckdb::ClientContext &context, duc
 		return;
 	}
 
-	auto hasTuple = local_state.m_heap_table_reader->ReadPageTuples(output);
+	if (global_state.m_index_scan) {
+		if (!global_state.m_index_scan->ReadTuples(output, local_state.m_local_state)) {
+			local_state.m_local_state->m_exhausted_scan = true;
+		}
+		return;
+	}
+
+	if (global_state.m_parallel_scan) {
+		if (!local_state.m_parallel_batch) {
+			local_state.m_parallel_batch = duckdb::make_uniq<PostgresParallelScanBatch>();
+		}
+		if (!global_state.m_parallel_scan->ReadTuples(output, local_state.m_local_state,
+		                                              *local_state.m_parallel_batch)) {
+			local_state.m_local_state->m_exhausted_scan = true;
+		}
+		return;
+	}
 
-	if (!hasTuple || local_state.m_heap_table_reader->GetCurrentBlockNumber() == InvalidBlockNumber) {
-		local_state.m_local_state->m_exhausted_scan = true;
+	while (true) {
+		auto hasTuple = local_state.m_heap_table_reader->ReadPageTuples(output);
+		if (hasTuple && local_state.m_heap_table_reader->GetCurrentBlockNumber() != InvalidBlockNumber) {
+			return;
+		}
+		if (!global_state.NextPartition(local_state)) {
+			local_state.m_local_state->m_exhausted_scan = true;
+			return;
+		}
+		/* An empty chunk would end the scan, so only return the rows of the finished partition */
+		if (output.size() > 0) {
+			return;
+		}
 	}
 }
 
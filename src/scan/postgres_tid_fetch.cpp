@@ -0,0 +1,328 @@
+#include "duckdb.hpp"
+
+extern "C" {
+#include "postgres.h"
+#include "access/heapam.h"
+#include "catalog/namespace.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "storage/bufpage.h"
+#include "utils/acl.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/rls.h"
+#include "utils/snapmgr.h"
+#include "utils/varlena.h"
+}
+
+#include "pgduckdb/pgduckdb_detoast.hpp"
+#include "pgduckdb/pgduckdb_process_lock.hpp"
+#include "pgduckdb/pgduckdb_types.hpp"
+#include "pgduckdb/pgduckdb_utils.hpp"
+#include "pgduckdb/catalog/pgduckdb_table.hpp"
+#include "pgduckdb/scan/postgres_scan.hpp"
+#include "pgduckdb/scan/postgres_tid_fetch.hpp"
+
+namespace pgduckdb {
+
+//
+// PostgresTidFetchFunctionData
+//
+
+PostgresTidFetchFunctionData::PostgresTidFetchFunctionData(::Relation rel, Snapshot snapshot)
+    : m_rel(rel), m_snapshot(snapshot), m_nblocks(0) {
+}
+
+PostgresTidFetchFunctionData::~PostgresTidFetchFunctionData() {
+	std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+	RelationClose(m_rel);
+}
+
+//
+// PostgresTidFetchLocalState
+//
+
+PostgresTidFetchLocalState::PostgresTidFetchLocalState(idx_t ncolumns) : m_buffer(InvalidBuffer) {
+	m_rowids.reserve(STANDARD_VECTOR_SIZE);
+	m_values = (Datum *)duckdb_malloc(sizeof(Datum) * ncolumns * STANDARD_VECTOR_SIZE);
+	m_nulls = (bool *)duckdb_malloc(sizeof(bool) * ncolumns * STANDARD_VECTOR_SIZE);
+}
+
+PostgresTidFetchLocalState::~PostgresTidFetchLocalState() {
+	/* If execution is interrupted while a block is converted release its pin now */
+	if (m_buffer != InvalidBuffer) {
+		std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+		ReleaseBuffer(m_buffer);
+	}
+	duckdb_free(m_values);
+	duckdb_free(m_nulls);
+}
+
+//
+// PostgresTidFetchFunction
+//
+
+PostgresTidFetchFunction::PostgresTidFetchFunction()
+    : TableFunction("postgres_tid_fetch", {duckdb::LogicalType::TABLE, duckdb::LogicalType::VARCHAR}, nullptr,
+                    PostgresTidFetchBind, nullptr, PostgresTidFetchInitLocal) {
+	named_parameters["columns"] = duckdb::LogicalType::LIST(duckdb::LogicalType::VARCHAR);
+	in_out_function = PostgresTidFetchFunc;
+}
+
+static Oid
+LookupRelation(const char *relation_name) {
+	List *name_list = textToQualifiedNameList(cstring_to_text(relation_name));
+	return RangeVarGetRelid(makeRangeVarFromNameList(name_list), AccessShareLock, false);
+}
+
+/*
+ * The rows are read by ctid without going through the executor, so check the
+ * SELECT privilege on the relation, or else on every fetched column, and
+ * refuse relations with RLS like the other Postgres table scans do.
+ */
+static void
+CheckSelectPermission(Oid relid, const duckdb::vector<AttrNumber> *attnums) {
+	if (pg_class_aclcheck(relid, GetUserId(), ACL_SELECT) != ACLCHECK_OK) {
+		for (auto attnum : *attnums) {
+			AclResult aclresult = pg_attribute_aclcheck(relid, attnum, GetUserId(), ACL_SELECT);
+			if (aclresult != ACLCHECK_OK) {
+				aclcheck_error(aclresult, get_relkind_objtype(get_rel_relkind(relid)), get_rel_name(relid));
+			}
+		}
+	}
+
+	if (check_enable_rls(relid, InvalidOid, false) == RLS_ENABLED) {
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+		                errmsg("(PGDuckDB/PostgresTidFetchBind) Cannot use \"%s\" in a DuckDB query, because RLS is "
+		                       "enabled on it",
+		                       get_rel_name(relid))));
+	}
+}
+
+duckdb::unique_ptr<duckdb::FunctionData>
+PostgresTidFetchFunction::PostgresTidFetchBind(duckdb::ClientContext &context, duckdb::TableFunctionBindInput &input,
+                                               duckdb::vector<duckdb::LogicalType> &types,
+                                               duckdb::vector<duckdb::string> &names) {
+	if (input.input_table_types.size() != 1 || input.input_table_types[0] != duckdb::LogicalType::BIGINT) {
+		throw duckdb::BinderException("(PGDuckDB/PostgresTidFetchBind) Input must be a single BIGINT rowid column");
+	}
+
+	auto relation_name = input.inputs[0].GetValue<duckdb::string>();
+	Oid relid;
+	Snapshot snapshot;
+	{
+		std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+		relid = PostgresFunctionGuard<Oid>(LookupRelation, relation_name.c_str());
+		snapshot = GetActiveSnapshot();
+	}
+
+	auto bind_data =
+	    duckdb::make_uniq<PostgresTidFetchFunctionData>(duckdb::PostgresTable::OpenRelation(relid), snapshot);
+	auto rel = bind_data->m_rel;
+	if (rel->rd_rel->relkind != RELKIND_RELATION && rel->rd_rel->relkind != RELKIND_MATVIEW) {
+		throw duckdb::BinderException("(PGDuckDB/PostgresTidFetchBind) \"%s\" is not a table", relation_name);
+	}
+	{
+		std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+		bind_data->m_nblocks = PostgresFunctionGuard<BlockNumber>(RelationGetNumberOfBlocksInFork, rel, MAIN_FORKNUM);
+	}
+
+	auto tuple_desc = RelationGetDescr(rel);
+	auto columns = input.named_parameters.find("columns");
+	if (columns == input.named_parameters.end()) {
+		for (int i = 0; i < tuple_desc->natts; i++) {
+			if (!TupleDescAttr(tuple_desc, i)->attisdropped) {
+				bind_data->m_attnums.push_back(i + 1);
+			}
+		}
+	} else {
+		for (auto &column : duckdb::ListValue::GetChildren(columns->second)) {
+			auto column_name = column.GetValue<duckdb::string>();
+			AttrNumber attnum = InvalidAttrNumber;
+			for (int i = 0; i < tuple_desc->natts; i++) {
+				auto attr = TupleDescAttr(tuple_desc, i);
+				if (!attr->attisdropped && column_name == NameStr(attr->attname)) {
+					attnum = i + 1;
+					break;
+				}
+			}
+			if (attnum == InvalidAttrNumber) {
+				throw duckdb::BinderException("(PGDuckDB/PostgresTidFetchBind) Column \"%s\" does not exist in \"%s\"",
+				                              column_name, relation_name);
+			}
+			bind_data->m_attnums.push_back(attnum);
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+		PostgresFunctionGuard(CheckSelectPermission, relid, &bind_data->m_attnums);
+	}
+
+	types.push_back(duckdb::LogicalType::BIGINT);
+	names.push_back("rowid");
+	for (auto attnum : bind_data->m_attnums) {
+		auto attr = TupleDescAttr(tuple_desc, attnum - 1);
+		types.push_back(ConvertPostgresToDuckColumnType(attr));
+		names.push_back(NameStr(attr->attname));
+	}
+
+	return std::move(bind_data);
+}
+
+duckdb::unique_ptr<duckdb::LocalTableFunctionState>
+PostgresTidFetchFunction::PostgresTidFetchInitLocal(duckdb::ExecutionContext &context,
+                                                    duckdb::TableFunctionInitInput &input,
+                                                    duckdb::GlobalTableFunctionState *gstate) {
+	auto &bind_data = input.bind_data->Cast<PostgresTidFetchFunctionData>();
+	return duckdb::make_uniq<PostgresTidFetchLocalState>(bind_data.m_attnums.size());
+}
+
+/*
+ * Read the rows of one block for the nrowids rowids, which are sorted by
+ * offset. The columns of the rows visible to the snapshot are
+ * stored in values/nulls and their rowids in fetched, returns the number of
+ * such rows. The buffer is returned pinned, but no longer locked. When an
+ * error is raised the buffer is unlocked and released before it propagates.
+ * Must be called with DuckdbProcessLock held.
+ */
+static idx_t
+FetchBlockRows(const PostgresTidFetchFunctionData &bind_data, BlockNumber block,
+               const std::pair<int64_t, idx_t> *rowids, idx_t nrowids, Datum *values, bool *nulls, int64_t *fetched,
+               Buffer *buffer) {
+	auto rel = bind_data.m_rel;
+	auto tuple_desc = RelationGetDescr(rel);
+	auto ncolumns = bind_data.m_attnums.size();
+	idx_t nfetched = 0;
+
+	*buffer = ReadBufferExtended(rel, MAIN_FORKNUM, block, RBM_NORMAL, nullptr);
+	LockBuffer(*buffer, BUFFER_LOCK_SHARE);
+
+	// clang-format off
+	PG_TRY();
+	{
+		Page page = BufferGetPage(*buffer);
+		OffsetNumber max_offset = PageGetMaxOffsetNumber(page);
+		HeapTupleData tuple;
+		tuple.t_tableOid = RelationGetRelid(rel);
+
+		for (idx_t i = 0; i < nrowids; i++) {
+			PostgresScanDecodeRowId(rowids[i].first, &tuple.t_self);
+			OffsetNumber offset = ItemPointerGetOffsetNumber(&tuple.t_self);
+			if (offset < FirstOffsetNumber || offset > max_offset) {
+				continue;
+			}
+			ItemId lpp = PageGetItemId(page, offset);
+			if (!ItemIdIsNormal(lpp)) {
+				continue;
+			}
+			tuple.t_data = (HeapTupleHeader)PageGetItem(page, lpp);
+			tuple.t_len = ItemIdGetLength(lpp);
+			if (!HeapTupleSatisfiesVisibility(&tuple, bind_data.m_snapshot, *buffer)) {
+				continue;
+			}
+
+			for (idx_t col = 0; col < ncolumns; col++) {
+				auto idx = col * STANDARD_VECTOR_SIZE + nfetched;
+				values[idx] = heap_getattr(&tuple, bind_data.m_attnums[col], tuple_desc, &nulls[idx]);
+			}
+			fetched[nfetched++] = rowids[i].first;
+		}
+	}
+	PG_CATCH();
+	{
+		UnlockReleaseBuffer(*buffer);
+		*buffer = InvalidBuffer;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	// clang-format on
+
+	LockBuffer(*buffer, BUFFER_LOCK_UNLOCK);
+	return nfetched;
+}
+
+/*
+ * Fetch the rows of an input chunk of rowids. The rowids are sorted first, so
+ * that every block is read and locked once, in block order. Values of a block
+ * are converted while only its pin is held.
+ */
+duckdb::OperatorResultType
+PostgresTidFetchFunction::PostgresTidFetchFunc(duckdb::ExecutionContext &context, duckdb::TableFunctionInput &data,
+                                               duckdb::DataChunk &input, duckdb::DataChunk &output) {
+	auto &bind_data = data.bind_data->Cast<PostgresTidFetchFunctionData>();
+	auto &local_state = data.local_state->Cast<PostgresTidFetchLocalState>();
+	auto tuple_desc = RelationGetDescr(bind_data.m_rel);
+	auto ncolumns = bind_data.m_attnums.size();
+
+	duckdb::UnifiedVectorFormat rowid_format;
+	input.data[0].ToUnifiedFormat(input.size(), rowid_format);
+	auto input_rowids = duckdb::UnifiedVectorFormat::GetData<int64_t>(rowid_format);
+
+	auto &rowids = local_state.m_rowids;
+	rowids.clear();
+	for (idx_t i = 0; i < input.size(); i++) {
+		auto idx = rowid_format.sel->get_index(i);
+		if (!rowid_format.validity.RowIsValid(idx) || input_rowids[idx] < 0 ||
+		    (BlockNumber)(input_rowids[idx] >> 16) >= bind_data.m_nblocks) {
+			continue;
+		}
+		rowids.emplace_back(input_rowids[idx], i);
+	}
+	std::sort(rowids.begin(), rowids.end());
+
+	auto output_rowids = duckdb::FlatVector::GetData<int64_t>(output.data[0]);
+	auto values = local_state.m_values;
+	auto nulls = local_state.m_nulls;
+	idx_t noutput = 0;
+
+	for (idx_t begin = 0; begin < rowids.size();) {
+		BlockNumber block = (BlockNumber)(rowids[begin].first >> 16);
+		idx_t end = begin + 1;
+		while (end < rowids.size() && (BlockNumber)(rowids[end].first >> 16) == block) {
+			end++;
+		}
+
+		idx_t nfetched;
+		{
+			std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+			nfetched = PostgresFunctionGuard<idx_t>(FetchBlockRows, bind_data, block, &rowids[begin], end - begin,
+			                                        values, nulls, output_rowids + noutput, &local_state.m_buffer);
+		}
+
+		for (idx_t col = 0; col < ncolumns; col++) {
+			auto attr = TupleDescAttr(tuple_desc, bind_data.m_attnums[col] - 1);
+			auto &result = output.data[col + 1];
+			for (idx_t row = 0; row < nfetched; row++) {
+				auto idx = col * STANDARD_VECTOR_SIZE + row;
+				if (nulls[idx]) {
+					duckdb::FlatVector::SetNull(result, noutput + row, true);
+					continue;
+				}
+				if (attr->attlen == -1) {
+					bool should_free = false;
+					Datum value = DetoastPostgresDatum(reinterpret_cast<varlena *>(values[idx]), &should_free);
+					ConvertPostgresToDuckValue(attr->atttypid, value, result, noutput + row);
+					if (should_free) {
+						duckdb_free(reinterpret_cast<void *>(value));
+					}
+				} else {
+					ConvertPostgresToDuckValue(attr->atttypid, values[idx], result, noutput + row);
+				}
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(DuckdbProcessLock::GetLock());
+			PostgresFunctionGuard(ReleaseBuffer, local_state.m_buffer);
+			local_state.m_buffer = InvalidBuffer;
+		}
+
+		noutput += nfetched;
+		begin = end;
+	}
+
+	output.SetCardinality(noutput);
+	return duckdb::OperatorResultType::NEED_MORE_INPUT;
+}
+
+} // namespace pgduckdb
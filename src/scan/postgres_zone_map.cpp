@@ -0,0 +1,352 @@
+#include "duckdb.hpp"
+
+extern "C" {
+#include "postgres.h"
+#include "access/htup_details.h"
+#include "catalog/pg_type.h"
+#include "utils/date.h"
+#include "utils/inval.h"
+#include "utils/timestamp.h"
+}
+
+#include "pgduckdb/pgduckdb.h"
+#include "pgduckdb/scan/postgres_index_pruning.hpp"
+#include "pgduckdb/scan/postgres_zone_map.hpp"
+
+#include <atomic>
+#include <cmath>
+
+namespace pgduckdb {
+
+/* Upper bound of the block ranges held by a backend, further ones are not recorded */
+#define PGDUCKDB_ZONE_MAP_MAX_RANGES (1 << 18)
+
+static std::mutex zone_maps_lock;
+static duckdb::unordered_map<Oid, duckdb::shared_ptr<PostgresZoneMapRelation>> zone_maps;
+static std::atomic<size_t> zone_map_nranges(0);
+
+/*
+ * Drop the zone maps of a relation on every relcache invalidation of it, this
+ * covers DROP, TRUNCATE and rewrites as well as VACUUM and ANALYZE, which
+ * merely make the next scans record the blocks again. Scans that still use the
+ * zone maps keep them until they finish.
+ */
+static void
+InvalidateZoneMaps(Datum /*arg*/, Oid relid) {
+	std::lock_guard<std::mutex> lock(zone_maps_lock);
+	if (OidIsValid(relid)) {
+		zone_maps.erase(relid);
+	} else {
+		zone_maps.clear();
+	}
+}
+
+void
+DuckdbInitZoneMaps(void) {
+	CacheRegisterRelcacheCallback(InvalidateZoneMaps, (Datum)0);
+}
+
+PostgresZoneMapRange::PostgresZoneMapRange() : m_has_values(false), m_has_nan(false) {
+	for (int i = 0; i < PGDUCKDB_ZONE_MAP_RANGE_BLOCKS; i++) {
+		m_lsns[i] = InvalidXLogRecPtr;
+	}
+	m_min.i = 0;
+	m_max.i = 0;
+}
+
+PostgresZoneMapRelation::~PostgresZoneMapRelation() {
+	for (auto &column : m_columns) {
+		zone_map_nranges -= column.second.size();
+	}
+}
+
+/* Types zone maps are kept for, all by-value and fixed-width */
+static bool
+ZoneMapType(Oid type_oid, bool *is_float) {
+	switch (type_oid) {
+	case BOOLOID:
+	case INT2OID:
+	case INT4OID:
+	case INT8OID:
+	case DATEOID:
+	case TIMESTAMPOID:
+	case TIMESTAMPTZOID:
+		*is_float = false;
+		return true;
+	case FLOAT4OID:
+	case FLOAT8OID:
+		*is_float = true;
+		return true;
+	default:
+		return false;
+	}
+}
+
+static PostgresZoneMapValue
+ZoneMapValue(Datum datum, Oid type_oid) {
+	PostgresZoneMapValue value;
+	switch (type_oid) {
+	case BOOLOID:
+		value.i = DatumGetBool(datum);
+		break;
+	case INT2OID:
+		value.i = DatumGetInt16(datum);
+		break;
+	case INT4OID:
+		value.i = DatumGetInt32(datum);
+		break;
+	case DATEOID:
+		value.i = DatumGetDateADT(datum);
+		break;
+	case FLOAT4OID:
+		value.f = DatumGetFloat4(datum);
+		break;
+	case FLOAT8OID:
+		value.f = DatumGetFloat8(datum);
+		break;
+	default:
+		value.i = DatumGetInt64(datum);
+		break;
+	}
+	return value;
+}
+
+static void
+WidenRange(PostgresZoneMapRange &range, PostgresZoneMapValue value, bool is_float) {
+	if (is_float && std::isnan(value.f)) {
+		range.m_has_nan = true;
+	} else if (!range.m_has_values) {
+		range.m_min = value;
+		range.m_max = value;
+		range.m_has_values = true;
+	} else if (is_float) {
+		range.m_min.f = std::min(range.m_min.f, value.f);
+		range.m_max.f = std::max(range.m_max.f, value.f);
+	} else {
+		range.m_min.i = std::min(range.m_min.i, value.i);
+		range.m_max.i = std::max(range.m_max.i, value.i);
+	}
+}
+
+template <class T>
+static bool
+BoundsExclude(T min, T max, bool max_is_nan, StrategyNumber strategy, T value) {
+	switch (strategy) {
+	case BTEqualStrategyNumber:
+		return value < min || (!max_is_nan && value > max);
+	case BTLessStrategyNumber:
+		return min >= value;
+	case BTLessEqualStrategyNumber:
+		return min > value;
+	case BTGreaterStrategyNumber:
+		return !max_is_nan && max <= value;
+	case BTGreaterEqualStrategyNumber:
+		return !max_is_nan && max < value;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Whether no value of the range satisfies the comparison. NULLs never do, so
+ * a range without values is always excluded. A NaN is larger than any other
+ * float, a range holding only NaNs has +Infinity as lower bound then.
+ */
+static bool
+RangeExcludes(const PostgresZoneMapRange &range, bool is_float, StrategyNumber strategy, PostgresZoneMapValue value) {
+	if (!range.m_has_values && !range.m_has_nan) {
+		return true;
+	}
+	if (is_float) {
+		double min = range.m_has_values ? range.m_min.f : INFINITY;
+		return BoundsExclude<double>(min, range.m_max.f, range.m_has_nan, strategy, value.f);
+	}
+	return BoundsExclude<int64_t>(range.m_min.i, range.m_max.i, false, strategy, value.i);
+}
+
+duckdb::unique_ptr<PostgresScanZoneMap>
+PostgresScanZoneMap::Create(Relation rel, const PostgresScanGlobalState &scan_global_state) {
+	/* Pages of relations that are not WAL-logged change without their LSN moving */
+	if (!duckdb_postgres_scan_zone_maps || !RelationNeedsWAL(rel) || !OidIsValid(rel->rd_rel->relfilenode)) {
+		return nullptr;
+	}
+
+	auto zone_map = duckdb::make_uniq<PostgresScanZoneMap>();
+	for (const auto &read_column : scan_global_state.m_deform_read_columns) {
+		bool is_float;
+		if (!ZoneMapType(read_column.atttypid, &is_float)) {
+			continue;
+		}
+		zone_map->m_columns.push_back({read_column.attnum, read_column.atttypid, is_float,
+		                               read_column.has_missing_value, read_column.missing_value});
+		if (!read_column.filter) {
+			continue;
+		}
+
+		duckdb::vector<std::pair<StrategyNumber, duckdb::Value>> comparisons;
+		PostgresScanFilterComparisons(*read_column.filter, comparisons);
+		for (auto &[strategy, constant] : comparisons) {
+			Datum datum;
+			if (!PostgresScanFilterConstantDatum(constant, read_column.atttypid, datum)) {
+				continue;
+			}
+			auto value = ZoneMapValue(datum, read_column.atttypid);
+			if (is_float && std::isnan(value.f)) {
+				continue;
+			}
+			zone_map->m_comparisons.push_back({read_column.attnum, is_float, strategy, value});
+		}
+	}
+
+	if (zone_map->m_columns.empty()) {
+		return nullptr;
+	}
+
+	int natts = zone_map->m_columns.back().attnum + 1;
+	zone_map->m_deform_attrs.assign(scan_global_state.m_deform_attrs.begin(),
+	                                scan_global_state.m_deform_attrs.begin() + natts);
+	zone_map->m_column_idx.assign(natts, -1);
+	for (idx_t i = 0; i < zone_map->m_columns.size(); i++) {
+		zone_map->m_column_idx[zone_map->m_columns[i].attnum] = i;
+	}
+
+	std::lock_guard<std::mutex> lock(zone_maps_lock);
+	auto &relation = zone_maps[RelationGetRelid(rel)];
+	if (!relation || relation->m_relfilenode != rel->rd_rel->relfilenode) {
+		relation = duckdb::make_shared_ptr<PostgresZoneMapRelation>();
+		relation->m_relfilenode = rel->rd_rel->relfilenode;
+	}
+	zone_map->m_relation = relation;
+	return zone_map;
+}
+
+/*
+ * The block is still the one that was recorded and a filter excludes every
+ * value its range holds. The LSN must be read with the buffer content lock
+ * held.
+ */
+bool
+PostgresScanZoneMap::CanSkipBlock(BlockNumber block, XLogRecPtr lsn) {
+	if (m_comparisons.empty() || lsn == InvalidXLogRecPtr) {
+		return false;
+	}
+
+	size_t range_idx = block / PGDUCKDB_ZONE_MAP_RANGE_BLOCKS;
+	int block_idx = block % PGDUCKDB_ZONE_MAP_RANGE_BLOCKS;
+	std::lock_guard<std::mutex> lock(m_relation->m_lock);
+	for (const auto &comparison : m_comparisons) {
+		auto column = m_relation->m_columns.find(comparison.attnum);
+		if (column == m_relation->m_columns.end() || range_idx >= column->second.size()) {
+			continue;
+		}
+		const auto &range = column->second[range_idx];
+		if (range.m_lsns[block_idx] == lsn &&
+		    RangeExcludes(range, comparison.is_float, comparison.strategy, comparison.value)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool
+PostgresScanZoneMap::BlockIsRecorded(BlockNumber block, XLogRecPtr lsn) {
+	size_t range_idx = block / PGDUCKDB_ZONE_MAP_RANGE_BLOCKS;
+	int block_idx = block % PGDUCKDB_ZONE_MAP_RANGE_BLOCKS;
+	std::lock_guard<std::mutex> lock(m_relation->m_lock);
+	for (const auto &column : m_columns) {
+		auto ranges = m_relation->m_columns.find(column.attnum);
+		if (ranges == m_relation->m_columns.end() || range_idx >= ranges->second.size() ||
+		    ranges->second[range_idx].m_lsns[block_idx] != lsn) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * Widen the summaries with the values of the recorded columns of the tuple.
+ * The tuple is walked with the deform plan of the scan up to the last
+ * recorded column, so neither the shared tuple descriptor nor any Postgres
+ * memory is touched. Columns the tuple is too short to contain have the
+ * attribute missing value, or are NULL.
+ */
+void
+PostgresScanZoneMap::SummarizeTuple(HeapTupleHeader tup, duckdb::vector<PostgresZoneMapRange> &summaries) {
+	int natts = std::min((int)HeapTupleHeaderGetNatts(tup), (int)m_deform_attrs.size());
+	bool hasnulls = (tup->t_infomask & HEAP_HASNULL) != 0;
+	char *tp = (char *)tup + tup->t_hoff;
+	bits8 *bp = tup->t_bits;
+	uint32 off = 0;
+
+	for (int attnum = 0; attnum < natts; attnum++) {
+		const auto &attr = m_deform_attrs[attnum];
+		if (hasnulls && att_isnull(attnum, bp)) {
+			continue;
+		}
+		if (attr.attlen == -1) {
+			off = att_align_pointer(off, attr.attalign, -1, tp + off);
+		} else {
+			off = att_align_nominal(off, attr.attalign);
+		}
+		int i = m_column_idx[attnum];
+		if (i >= 0) {
+			Datum value = fetch_att(tp + off, attr.attbyval, attr.attlen);
+			WidenRange(summaries[i], ZoneMapValue(value, m_columns[i].type_oid), m_columns[i].is_float);
+		}
+		off = att_addlength_pointer(off, attr.attlen, tp + off);
+	}
+
+	for (int attnum = natts; attnum < (int)m_deform_attrs.size(); attnum++) {
+		int i = m_column_idx[attnum];
+		if (i >= 0 && m_columns[i].has_missing_value) {
+			WidenRange(summaries[i], ZoneMapValue(m_columns[i].missing_value, m_columns[i].type_oid),
+			           m_columns[i].is_float);
+		}
+	}
+}
+
+/*
+ * Summarize the tuples of the line pointers up to max_offset, which was read
+ * together with the LSN under the buffer content lock. The buffer must stay
+ * pinned, so none of these line pointers can be pruned meanwhile. Runs
+ * without DuckdbProcessLock, see SummarizeTuple.
+ */
+void
+PostgresScanZoneMap::RecordBlock(BlockNumber block, XLogRecPtr lsn, Page page, OffsetNumber max_offset) {
+	if (lsn == InvalidXLogRecPtr || BlockIsRecorded(block, lsn)) {
+		return;
+	}
+
+	duckdb::vector<PostgresZoneMapRange> summaries(m_columns.size());
+	for (OffsetNumber offset = FirstOffsetNumber; offset <= max_offset; offset++) {
+		ItemId lpp = PageGetItemId(page, offset);
+		if (ItemIdIsNormal(lpp)) {
+			SummarizeTuple((HeapTupleHeader)PageGetItem(page, lpp), summaries);
+		}
+	}
+
+	size_t range_idx = block / PGDUCKDB_ZONE_MAP_RANGE_BLOCKS;
+	int block_idx = block % PGDUCKDB_ZONE_MAP_RANGE_BLOCKS;
+	std::lock_guard<std::mutex> lock(m_relation->m_lock);
+	for (idx_t i = 0; i < m_columns.size(); i++) {
+		auto &ranges = m_relation->m_columns[m_columns[i].attnum];
+		if (range_idx >= ranges.size()) {
+			size_t nnew = range_idx + 1 - ranges.size();
+			if (zone_map_nranges + nnew > PGDUCKDB_ZONE_MAP_MAX_RANGES) {
+				continue;
+			}
+			zone_map_nranges += nnew;
+			ranges.resize(range_idx + 1);
+		}
+		auto &range = ranges[range_idx];
+		const auto &summary = summaries[i];
+		if (summary.m_has_values) {
+			WidenRange(range, summary.m_min, m_columns[i].is_float);
+			WidenRange(range, summary.m_max, m_columns[i].is_float);
+		}
+		range.m_has_nan |= summary.m_has_nan;
+		range.m_lsns[block_idx] = lsn;
+	}
+}
+
+} // namespace pgduckdb
@@ -0,0 +1,16 @@
+-- Filters of medium selectivity on btree indexed columns restrict the scan to
+-- the blocks of a bitmap built from the indexes, ORs of the leading column
+-- union the bitmaps of their disjuncts.
+CREATE TABLE bitmap_scan(id int, a int, b int);
+INSERT INTO bitmap_scan SELECT i, i % 50, i % 30 FROM generate_series(1, 20000) i;
+CREATE INDEX ON bitmap_scan (a);
+CREATE INDEX ON bitmap_scan (b);
+ANALYZE bitmap_scan;
+SELECT count(*), min(id), max(id) FROM bitmap_scan WHERE a = 5 AND b = 5;
+SELECT count(*) FROM bitmap_scan WHERE a IN (5, 7);
+SELECT count(*), min(id), max(id) FROM bitmap_scan WHERE (a = 5 OR a = 6) AND b = 6;
+SELECT count(*) FROM bitmap_scan WHERE a = 5 AND b BETWEEN 0 AND 9;
+SET duckdb.postgres_scan_use_index = false;
+SELECT count(*), min(id), max(id) FROM bitmap_scan WHERE a = 5 AND b = 5;
+RESET duckdb.postgres_scan_use_index;
+DROP TABLE bitmap_scan;
@@ -0,0 +1,23 @@
+-- Postgres scans only read the block ranges that BRIN indexes keep for the
+-- pushed down filters, results have to be the same as with a full scan.
+CREATE TABLE brin_pruning(id int, day date, name text);
+INSERT INTO brin_pruning SELECT i, '2024-01-01'::date + i / 100, 'n' || i FROM generate_series(1, 10000) i;
+CREATE INDEX ON brin_pruning USING brin (id) WITH (pages_per_range = 1);
+CREATE INDEX ON brin_pruning USING brin (day, name) WITH (pages_per_range = 2);
+SELECT count(*), min(id), max(id) FROM brin_pruning WHERE id BETWEEN 2000 AND 2999;
+SELECT count(*) FROM brin_pruning WHERE day >= '2024-03-01' AND day < '2024-03-02';
+SELECT id FROM brin_pruning WHERE name = 'n4242' AND id > 4000;
+-- ORs are not used for pruning
+SELECT id FROM brin_pruning WHERE id = 5 OR id = 9000 ORDER BY id;
+-- Rows in block ranges that are not summarized yet are always read
+INSERT INTO brin_pruning VALUES (20000, '2030-01-01', 'late');
+SELECT id FROM brin_pruning WHERE id > 9998 ORDER BY id;
+SELECT id FROM brin_pruning WHERE day > '2029-12-31';
+-- Partial BRIN indexes only summarize the rows matching their predicate, they are not used
+CREATE INDEX brin_pruning_partial ON brin_pruning USING brin (id) WITH (pages_per_range = 1) WHERE id > 5000;
+SELECT count(*), min(id), max(id) FROM brin_pruning WHERE id BETWEEN 2000 AND 2999;
+DROP INDEX brin_pruning_partial;
+SET duckdb.postgres_scan_use_brin = false;
+SELECT count(*), min(id), max(id) FROM brin_pruning WHERE id BETWEEN 2000 AND 2999;
+RESET duckdb.postgres_scan_use_brin;
+DROP TABLE brin_pruning;
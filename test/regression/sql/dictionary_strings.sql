@@ -0,0 +1,10 @@
+CREATE TABLE dict_strings(a int, status text, name text);
+INSERT INTO dict_strings SELECT i, CASE i % 4 WHEN 0 THEN 'open' WHEN 1 THEN 'closed' WHEN 2 THEN NULL ELSE 'pending' END, CASE WHEN i > 4000 THEN 'name_' || i ELSE 'name' END FROM generate_series(1, 5000) i;
+SELECT status, count(*) FROM dict_strings GROUP BY status ORDER BY status;
+-- name has too many distinct values for a dictionary once i > 4000
+SELECT count(DISTINCT name), min(name), max(name) FROM dict_strings;
+SELECT status, name FROM dict_strings WHERE a IN (1, 2, 4001, 4002, 5000) ORDER BY a;
+-- With statistics, name has too many distinct values per row to be tried at all
+ANALYZE dict_strings;
+SELECT count(DISTINCT name), min(name), max(name) FROM dict_strings;
+DROP TABLE dict_strings;
@@ -0,0 +1,21 @@
+-- The row with id 100 holds a two dimensional array in a one dimensional
+-- column, converting it to DuckDB fails. Queries that read arr only succeed
+-- when the pushed down filters discard that row before conversion.
+CREATE TABLE filter_pushdown(id int, name text, score float8, arr int[]);
+INSERT INTO filter_pushdown SELECT i, 'name_' || i, i / 4.0, ARRAY[i, i + 1] FROM generate_series(1, 50) i;
+INSERT INTO filter_pushdown VALUES (100, 'a', 0, '{{1, 2}, {3, 4}}');
+SELECT arr FROM filter_pushdown ORDER BY id;
+-- OR of equalities, pushed down as an IN-list
+SELECT id, arr FROM filter_pushdown WHERE id = 1 OR id = 2 OR id = 40 ORDER BY id;
+SELECT id, arr FROM filter_pushdown WHERE id IN (3, 5, 7, 11, 13, 17, 19, 23, 29, 31) ORDER BY id;
+-- LIKE with a constant prefix, pushed down as a string range
+SELECT id, arr FROM filter_pushdown WHERE name LIKE 'name_4%' ORDER BY id;
+-- IN-lists on other types, without the column that fails to convert
+SELECT id FROM filter_pushdown WHERE name IN ('name_7', 'name_8', 'missing') ORDER BY id;
+SELECT id FROM filter_pushdown WHERE score IN (0.25, 2.5, 12.5) ORDER BY id;
+SELECT count(*) FROM filter_pushdown WHERE id IN (1, 2, NULL);
+-- NaN equals NaN in Postgres, with short and hashed IN-lists
+INSERT INTO filter_pushdown VALUES (101, 'nan', 'NaN', NULL);
+SELECT id FROM filter_pushdown WHERE score IN ('NaN', 0.25) ORDER BY id;
+SELECT id FROM filter_pushdown WHERE score IN ('NaN', 1, 2, 3, 4, 5, 6, 7, 8) ORDER BY id;
+DROP TABLE filter_pushdown;
@@ -0,0 +1,24 @@
+-- Scans reading only columns of a btree index that is much smaller than the
+-- table read the index instead, rows of all-visible pages come from it alone.
+CREATE TABLE index_only_scan(id int PRIMARY KEY, k int, v int, pad text);
+INSERT INTO index_only_scan SELECT i, i % 100, i * 2, repeat('x', 200) FROM generate_series(1, 10000) i;
+CREATE INDEX ON index_only_scan (k) INCLUDE (v);
+VACUUM ANALYZE index_only_scan;
+SELECT count(*), sum(k), sum(v) FROM index_only_scan;
+-- COUNT(*) scans look like scans of the rowid alone, they read the heap
+SELECT count(*) FROM index_only_scan;
+-- Updated rows are not on all-visible pages and are read from the heap
+UPDATE index_only_scan SET v = v + 1 WHERE id <= 10;
+SELECT count(*), sum(v) FROM index_only_scan;
+SELECT count(*), sum(v) FROM index_only_scan WHERE k = 5;
+DELETE FROM index_only_scan WHERE id > 9990;
+SELECT count(*), max(v) FROM index_only_scan;
+SET duckdb.postgres_scan_use_index = false;
+SELECT count(*), sum(v) FROM index_only_scan;
+RESET duckdb.postgres_scan_use_index;
+-- OR filters are applied to whole batches of index rows
+SELECT count(*), sum(v) FROM index_only_scan WHERE k = 1 OR k > 90;
+-- Expression columns of an index have no table column to return
+CREATE INDEX index_only_scan_expr ON index_only_scan (k, (v % 7));
+SELECT count(*), sum(k) FROM index_only_scan;
+DROP TABLE index_only_scan;
@@ -0,0 +1,16 @@
+-- Selective filters on the leading column of a btree index are answered
+-- through an index scan, the filters are still applied to the fetched rows.
+CREATE TABLE index_scan(id int PRIMARY KEY, grp int, name text);
+INSERT INTO index_scan SELECT i, i % 100, 'n' || i FROM generate_series(1, 10000) i;
+CREATE INDEX ON index_scan (grp, id);
+ANALYZE index_scan;
+SELECT * FROM index_scan WHERE id = 42;
+SELECT count(*), min(id), max(id) FROM index_scan WHERE id BETWEEN 100 AND 149;
+SELECT id FROM index_scan WHERE grp = 7 AND id < 300 ORDER BY id;
+SELECT id FROM index_scan WHERE id = 42 AND name = 'n43';
+DELETE FROM index_scan WHERE id = 43;
+SELECT id FROM index_scan WHERE id = 43;
+SET duckdb.postgres_scan_use_index = false;
+SELECT * FROM index_scan WHERE id = 42;
+RESET duckdb.postgres_scan_use_index;
+DROP TABLE index_scan;
@@ -0,0 +1,21 @@
+-- ORDER BY ... LIMIT and MIN/MAX over a btree indexed column read the first
+-- rows of an ordered index scan, DuckDB still sorts and limits them.
+CREATE TABLE ordered_scan(id int PRIMARY KEY, ts timestamp, v float8);
+INSERT INTO ordered_scan SELECT i, '2024-01-01'::timestamp + i * interval '1 minute',
+    CASE WHEN i % 1000 = 0 THEN NULL ELSE i * 0.5 END FROM generate_series(1, 10000) i;
+CREATE INDEX ON ordered_scan (ts);
+CREATE INDEX ON ordered_scan (v DESC);
+ANALYZE ordered_scan;
+SELECT id FROM ordered_scan ORDER BY ts DESC LIMIT 3;
+SELECT id FROM ordered_scan ORDER BY id LIMIT 3 OFFSET 2;
+SELECT id, v FROM ordered_scan ORDER BY v DESC NULLS LAST LIMIT 2;
+SELECT count(v), count(*) FROM (SELECT v FROM ordered_scan ORDER BY v NULLS FIRST LIMIT 12) s;
+SELECT max(id) FROM ordered_scan;
+SELECT min(v) FROM ordered_scan;
+SELECT id FROM ordered_scan WHERE v > 100 ORDER BY ts LIMIT 2;
+UPDATE ordered_scan SET ts = ts + interval '1 year' WHERE id = 5;
+SELECT id FROM ordered_scan ORDER BY ts DESC LIMIT 1;
+SET duckdb.postgres_scan_use_index = false;
+SELECT id FROM ordered_scan ORDER BY ts DESC LIMIT 2;
+RESET duckdb.postgres_scan_use_index;
+DROP TABLE ordered_scan;
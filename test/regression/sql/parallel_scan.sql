@@ -0,0 +1,19 @@
+-- Parallel workers read the heap and send the visible tuples to the backend
+SET duckdb.postgres_scan_parallel_workers = 2;
+SET min_parallel_table_scan_size = 0;
+CREATE TABLE parallel_scan(id int, name text);
+INSERT INTO parallel_scan SELECT i, 'name ' || i FROM generate_series(1, 10000) i;
+DELETE FROM parallel_scan WHERE id > 9000;
+SELECT count(*) FROM parallel_scan;
+SELECT count(*), sum(id), max(name) FROM parallel_scan;
+SELECT count(*), sum(id) FROM parallel_scan WHERE id % 7 = 0;
+SELECT name FROM parallel_scan WHERE id = 4321;
+-- OR filters are applied to batches of received tuples
+SELECT count(*), sum(id) FROM parallel_scan WHERE id < 100 OR id > 8500;
+-- The launched workers are reported at DEBUG1
+SET client_min_messages = debug1;
+SELECT count(*) FROM parallel_scan;
+RESET client_min_messages;
+RESET min_parallel_table_scan_size;
+RESET duckdb.postgres_scan_parallel_workers;
+DROP TABLE parallel_scan;
@@ -0,0 +1,22 @@
+-- Partitioned tables are read through their leaf partitions, partitions whose
+-- constraint contradicts the pushed down filters are not read at all.
+CREATE TABLE partitioned_scan(id int, v int) PARTITION BY RANGE (id);
+CREATE TABLE partitioned_scan_1 PARTITION OF partitioned_scan FOR VALUES FROM (1) TO (1001);
+CREATE TABLE partitioned_scan_2 PARTITION OF partitioned_scan FOR VALUES FROM (1001) TO (2001);
+CREATE TABLE partitioned_scan_3 PARTITION OF partitioned_scan FOR VALUES FROM (2001) TO (3001);
+INSERT INTO partitioned_scan SELECT i, i % 10 FROM generate_series(1, 3000) i;
+SELECT count(*), sum(id) FROM partitioned_scan;
+SELECT count(*), sum(id) FROM partitioned_scan WHERE id > 2500;
+SELECT count(*), sum(id) FROM partitioned_scan WHERE id >= 900 AND id <= 1100;
+SELECT count(*) FROM partitioned_scan WHERE id > 5000;
+SELECT count(*) FROM partitioned_scan WHERE v = 3;
+DROP TABLE partitioned_scan;
+-- DuckDB compares strings bytewise, partitions of a key with a collation
+-- are only excluded by equality filters
+CREATE TABLE partitioned_scan_text(name text COLLATE "en-x-icu") PARTITION BY RANGE (name);
+CREATE TABLE partitioned_scan_text_1 PARTITION OF partitioned_scan_text FOR VALUES FROM (MINVALUE) TO ('m');
+CREATE TABLE partitioned_scan_text_2 PARTITION OF partitioned_scan_text FOR VALUES FROM ('m') TO (MAXVALUE);
+INSERT INTO partitioned_scan_text VALUES ('apple'), ('Banana'), ('melon'), ('Zucchini');
+SELECT name FROM partitioned_scan_text WHERE name < 'a' ORDER BY name;
+SELECT name FROM partitioned_scan_text WHERE name = 'melon';
+DROP TABLE partitioned_scan_text;
@@ -31,3 +31,10 @@ SELECT a, c FROM query_filter_output_column WHERE b = 't1';
 -- All columns in tuple unordered
 SELECT c, a, b FROM query_filter_output_column WHERE a = 2;
 DROP TABLE query_filter_output_column;
+
+CREATE TABLE query_filter_nulls(a INT, b INT);
+INSERT INTO query_filter_nulls VALUES (1, NULL), (2, 0), (NULL, 3);
+-- NULL values never pass a comparison
+SELECT COUNT(*) FROM query_filter_nulls WHERE b >= 0;
+SELECT COUNT(*) FROM query_filter_nulls WHERE a < 5 AND b > -1;
+DROP TABLE query_filter_nulls;
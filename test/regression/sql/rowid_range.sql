@@ -0,0 +1,11 @@
+-- Comparisons of the rowid with constants only read the blocks of that ctid
+-- range. 15 rows fit on a page, so block 2 starts with id 31.
+CREATE TABLE rowid_range(id int, pad text);
+INSERT INTO rowid_range SELECT i, repeat('x', 500) FROM generate_series(1, 1000) i;
+SELECT count(*), min(id), max(id) FROM rowid_range WHERE ctid >= '(2,0)' AND ctid < '(4,0)';
+SELECT duckdb.raw_query($$
+    SELECT count(*), min(id), max(id) FROM pgduckdb.public.rowid_range WHERE rowid >= 131072 AND rowid < 262144
+$$);
+SELECT duckdb.raw_query($$ SELECT id FROM pgduckdb.public.rowid_range WHERE rowid = 327681 $$);
+SELECT duckdb.raw_query($$ SELECT count(*) FROM pgduckdb.public.rowid_range WHERE rowid > 1000000000000 $$);
+DROP TABLE rowid_range;
@@ -0,0 +1,16 @@
+-- Heap readers of tables larger than a quarter of shared_buffers join the
+-- synchronized scans of the table: they start where the other scans are and
+-- wrap around at the end, results are the same as from the first block on.
+SET synchronize_seqscans = on;
+CREATE TABLE sync_scan(id int, pad text);
+INSERT INTO sync_scan SELECT i, repeat('x', 200) FROM generate_series(1, 200000) i;
+-- Leave the scan location of the table in the middle with a Postgres scan
+SET duckdb.force_execution = false;
+SET max_parallel_workers_per_gather = 0;
+SELECT id FROM sync_scan WHERE id = 100000 LIMIT 1;
+RESET max_parallel_workers_per_gather;
+RESET duckdb.force_execution;
+SELECT count(*), sum(id), min(id), max(id) FROM sync_scan;
+SELECT count(*), sum(id) FROM sync_scan WHERE id % 1000 = 0;
+RESET synchronize_seqscans;
+DROP TABLE sync_scan;
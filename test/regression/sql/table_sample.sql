@@ -0,0 +1,17 @@
+-- SYSTEM and BERNOULLI samples are drawn by the heap readers, SYSTEM reads
+-- only the sampled blocks. The same seed returns the same sample.
+CREATE TABLE table_sample(id int);
+INSERT INTO table_sample SELECT i FROM generate_series(1, 100000) i;
+SELECT duckdb.raw_query($$
+    SELECT count(*) BETWEEN 5000 AND 15000 AS in_range FROM pgduckdb.public.table_sample TABLESAMPLE 10% (system, 42)
+$$);
+SELECT duckdb.raw_query($$
+    SELECT count(*) BETWEEN 8000 AND 12000 AS in_range FROM pgduckdb.public.table_sample TABLESAMPLE 10% (bernoulli, 42)
+$$);
+SELECT duckdb.raw_query($$
+    SELECT (SELECT sum(id) FROM pgduckdb.public.table_sample TABLESAMPLE 5% (system, 7)) =
+           (SELECT sum(id) FROM pgduckdb.public.table_sample TABLESAMPLE 5% (system, 7)) AS same
+$$);
+SELECT duckdb.raw_query($$ SELECT count(*) FROM pgduckdb.public.table_sample TABLESAMPLE 100% (bernoulli, 1) $$);
+SELECT duckdb.raw_query($$ SELECT count(*) FROM pgduckdb.public.table_sample TABLESAMPLE 0% (system, 1) $$);
+DROP TABLE table_sample;
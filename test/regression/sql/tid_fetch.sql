@@ -0,0 +1,14 @@
+CREATE TABLE tid_fetch(id int, doc text);
+INSERT INTO tid_fetch SELECT i, repeat('d', i) FROM generate_series(1, 1000) i;
+DELETE FROM tid_fetch WHERE id = 6;
+-- The rowid of a Postgres table carries the ctid of the row
+SELECT duckdb.raw_query($$ SELECT count(*), count(DISTINCT rowid) FROM pgduckdb.public.tid_fetch $$);
+-- Filter on the narrow column first and fetch the wide one only for the rows that are left
+SELECT duckdb.raw_query($$
+    SELECT id, length(doc) FROM postgres_tid_fetch(
+        (SELECT rowid FROM pgduckdb.public.tid_fetch WHERE id % 250 = 3 OR id = 6), 'public.tid_fetch',
+        columns := ['id', 'doc'])
+    ORDER BY id
+$$);
+DROP TABLE tid_fetch;
+
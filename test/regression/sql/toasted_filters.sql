@@ -0,0 +1,16 @@
+-- Filters on TOASTed values, ext is stored out of line without compression,
+-- cmp compresses inline and big is stored out of line.
+CREATE TABLE toasted_filters(id int, ext text, cmp text, big text);
+ALTER TABLE toasted_filters ALTER COLUMN ext SET STORAGE EXTERNAL;
+INSERT INTO toasted_filters SELECT 1, repeat('x', 10000), repeat('y', 10000), string_agg(md5(i::text), '') FROM generate_series(1, 300) i;
+INSERT INTO toasted_filters SELECT 2, repeat('x', 9999) || 'z', 'short', string_agg(md5(i::text), '') FROM generate_series(2, 301) i;
+INSERT INTO toasted_filters VALUES (3, 'x', repeat('y', 9999), 'c4ca');
+SELECT id FROM toasted_filters WHERE ext = repeat('x', 10000);
+SELECT id FROM toasted_filters WHERE ext LIKE 'xxxx%' ORDER BY id;
+SELECT id FROM toasted_filters WHERE ext > 'xxxxx' ORDER BY id;
+SELECT id FROM toasted_filters WHERE cmp IN ('short', repeat('y', 10000)) ORDER BY id;
+SELECT id FROM toasted_filters WHERE cmp = repeat('y', 9999);
+SELECT id FROM toasted_filters WHERE big LIKE 'c4ca4238%';
+SELECT id FROM toasted_filters WHERE big = 'c4ca';
+SELECT id, length(big) FROM toasted_filters WHERE big >= 'c4ca' ORDER BY id;
+DROP TABLE toasted_filters;
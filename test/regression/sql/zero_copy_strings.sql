@@ -0,0 +1,11 @@
+SET duckdb.postgres_scan_zero_copy_strings = true;
+CREATE TABLE zero_copy(a int, b text, c varchar(20), d char(5));
+INSERT INTO zero_copy SELECT i, CASE WHEN i % 10 = 0 THEN NULL ELSE 'value_' || repeat('x', i % 30) END, 'c' || i, 'd' || (i % 3) FROM generate_series(1, 3000) i;
+-- Compressed inline value, detoasted and copied
+INSERT INTO zero_copy VALUES (3001, repeat('toasted', 1000), 'big', 'e');
+SELECT count(*), count(b), count(DISTINCT b), max(length(b)) FROM zero_copy;
+SELECT d::text AS d, count(*) FROM zero_copy GROUP BY d ORDER BY d;
+SELECT a, b, c FROM zero_copy WHERE a IN (1, 2, 10, 29) ORDER BY a;
+SELECT a, length(b), c, d::text FROM zero_copy WHERE a > 3000;
+DROP TABLE zero_copy;
+RESET duckdb.postgres_scan_zero_copy_strings;
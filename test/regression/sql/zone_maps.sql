@@ -0,0 +1,16 @@
+-- The first scan records zone maps, later scans skip the blocks they exclude.
+-- Blocks that change afterwards have to be read again.
+CREATE TABLE zone_maps(id int, ts timestamp, score float8);
+INSERT INTO zone_maps SELECT i, '2024-01-01'::timestamp + i * interval '1 minute', i / 10.0 FROM generate_series(1, 20000) i;
+SELECT count(id), count(ts), count(score) FROM zone_maps;
+SELECT count(*), min(id), max(id) FROM zone_maps WHERE id BETWEEN 15000 AND 15099;
+SELECT id FROM zone_maps WHERE ts = '2024-01-05 00:00:00';
+SELECT count(*) FROM zone_maps WHERE score > 1999.5;
+UPDATE zone_maps SET id = 15050 WHERE id = 10;
+SELECT count(*) FROM zone_maps WHERE id = 15050;
+INSERT INTO zone_maps VALUES (30000, NULL, 'NaN');
+SELECT id FROM zone_maps WHERE score > 5000;
+SET duckdb.postgres_scan_zone_maps = false;
+SELECT count(*), min(id), max(id) FROM zone_maps WHERE id BETWEEN 15000 AND 15099;
+RESET duckdb.postgres_scan_zone_maps;
+DROP TABLE zone_maps;